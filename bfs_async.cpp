@@ -1,8 +1,18 @@
 #include <iostream>
+#include <atomic>
+#include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <random>
+#include <functional>
+#include <cmath>
+#include <string>
 #include <mpi.h>
 #include <unistd.h> 
+#include "csr_graph.h"
+#include "rank_log.h"
+#include "thread_pool.h"
+#include "tree_collectives.h"
 using namespace std;
 
 const int MC_PROPOSE_TAG = 10;
@@ -10,37 +20,78 @@ const int MP_ACCEPT_TAG = 11;
 const int MR_REJECT_TAG = 12;
 const int MS_SYNC_TAG    = 13; 
 const int MC_COMPLETE_TAG = 14; 
-const int M_TERMINATE_TAG = 15;
 const int ROOT_RANK = 0; 
 
+const int64_t PRINT_LIMIT = 64;           // per-vertex output only for small graphs
+const uint64_t GRAPH500_SEED = 20251017;
+
 struct RSTMessage {
     int sender_rank;
 };
-vector<vector<int>> get_graph_topology(int world_size) {
-    if (world_size == 4) {
-        return {{1, 3},{0, 2},{1, 3},{0, 2}};
-    } 
-    return vector<vector<int>>(world_size); 
-}
-
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+// Rank-level topology, one vertex per rank. spec is "ring" (the default, the
+// old hardcoded 4-ring generalised), "torus" (a near-square 2D torus) or an
+// edge-list file over rank ids. Neighbour lists are sorted and deduplicated.
+// The result is empty if the file cannot be read, names a rank outside the
+// world, or leaves some rank unreachable from the root.
+vector<vector<int>> get_graph_topology(int world_size, const string& spec = "ring") {
+    vector<vector<int>> adj(world_size);
+    auto link = [&](int a, int b) {
+        if (a == b) return;
+        adj[a].push_back(b);
+        adj[b].push_back(a);
+    };
+    if (spec.empty() || spec == "ring") {
+        for (int r = 0; r < world_size && world_size > 1; ++r) link(r, (r + 1) % world_size);
+    }
+    else if (spec == "torus") {
+        int cols = max(1, (int)sqrt((double)world_size));
+        while (world_size % cols) cols--;
+        int rows = world_size / cols;
+        for (int r = 0; r < world_size; ++r) {
+            int row = r / cols, col = r % cols;
+            link(r, row * cols + (col + 1) % cols);
+            link(r, ((row + 1) % rows) * cols + col);
+        }
+    }
+    else {
+        vector<HalfEdge> edges;
+        bool weighted;
+        if (!read_edge_list_chunk(spec, 0, 1, edges, weighted)) return {};
+        for (const HalfEdge& e : edges) {
+            if (e.u < 0 || e.v < 0 || e.u >= world_size || e.v >= world_size) return {};
+            link((int)e.u, (int)e.v);
+        }
+    }
+    for (auto& nbrs : adj) {
+        sort(nbrs.begin(), nbrs.end());
+        nbrs.erase(unique(nbrs.begin(), nbrs.end()), nbrs.end());
+    }
 
-    int world_rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
-    int world_size;
-    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    vector<char> seen(world_size, 0);
+    vector<int> stack = {ROOT_RANK};
+    seen[ROOT_RANK] = 1;
+    int reached = 1;
+    while (!stack.empty()) {
+        int r = stack.back();
+        stack.pop_back();
+        for (int nb : adj[r])
+            if (!seen[nb]) { seen[nb] = 1; reached++; stack.push_back(nb); }
+    }
+    if (reached != world_size) return {};
+    return adj;
+}
 
+// The original one-vertex-per-rank protocol: a parent releases its children
+// level by level with MS_SYNC and collects MC_COMPLETE from their subtrees.
+int run_sync_protocol(int world_rank, int world_size, const string& topology) {
     if (world_size < 2) {
         if (world_rank == 0) cerr << "at least 2 processes required" << endl;
-        MPI_Finalize();
         return 0;
     }
 
-    const vector<vector<int>> adjacency_list = get_graph_topology(world_size);
+    const vector<vector<int>> adjacency_list = get_graph_topology(world_size, topology);
     if (adjacency_list.empty()) {
-         if (world_rank == 0) cerr << "Error: No topology defined for size " << world_size << endl;
-         MPI_Finalize();
+         if (world_rank == 0) cerr << "Error: topology '" << topology << "' is unreadable or not connected for size " << world_size << endl;
          return 1;
     }
     const vector<int>& neighbors = adjacency_list[world_rank];
@@ -52,12 +103,16 @@ int main(int argc, char** argv) {
     int no_response_remaining = 0; 
     int children_yet_to_complete = 0;
 
+    // termination and the final tree-wide reduction travel over the tree being built
+    TreeCollectives tree(MPI_COMM_WORLD);
+    RankLog event_log("bfs_async", world_rank);
     RSTMessage received_msg;
     MPI_Request recv_request; 
     MPI_Status recv_status;
     
     if (world_rank == ROOT_RANK) {
-        cout << "\nRank " << world_rank << " (ROOT) initiating Level 0 proposals." << endl;
+        cout << "Per-event log: bfs_async.rank<N>.log" << endl;
+        RLOG(LOG_INFO, EV_SEND, "(ROOT) initiating Level 0 proposals.", -1, MC_PROPOSE_TAG);
         RSTMessage send_mc_msg = {world_rank};
         for (int dest_rank : neighbors) {
             MPI_Send(&send_mc_msg, sizeof(RSTMessage), MPI_BYTE, dest_rank, MC_PROPOSE_TAG, MPI_COMM_WORLD);
@@ -66,11 +121,11 @@ int main(int argc, char** argv) {
         level_status = 1;
     } 
     else {
-        cout << "Rank " << world_rank << ": Waiting for first MC message to select parent." << endl;
+        RLOG(LOG_DEBUG, EV_STATE, "Waiting for first MC message to select parent.");
         MPI_Recv(&received_msg, sizeof(RSTMessage), MPI_BYTE, MPI_ANY_SOURCE, MC_PROPOSE_TAG, MPI_COMM_WORLD, &recv_status);
         
         parent_rank = received_msg.sender_rank;
-        cout << "Rank " << world_rank << ": First MC received from " << parent_rank << ". Parent set to " << parent_rank << "." << endl;
+        RLOG(LOG_INFO, EV_RECV, "First MC received from {peer}. Parent set to {peer}.", parent_rank, MC_PROPOSE_TAG);
         
         RSTMessage send_mp_msg = {world_rank};
         MPI_Send(&send_mp_msg, sizeof(RSTMessage), MPI_BYTE, parent_rank, MP_ACCEPT_TAG, MPI_COMM_WORLD);        
@@ -91,40 +146,34 @@ int main(int argc, char** argv) {
                 if (level_status == 1) {
                     children.push_back(sender_rank);
                     no_response_remaining--;
-                    cout << "Rank " << world_rank << ": Accepted as parent by " << sender_rank << " (MP). Resp left: " << no_response_remaining << endl;
+                    RLOG(LOG_INFO, EV_RECV, "Accepted as parent by {peer} (MP). Resp left: {a}", sender_rank, received_tag, 0, no_response_remaining);
                 }
             } 
             else if (received_tag == MC_COMPLETE_TAG) {
                 if (level_status == 2) {
                     children_yet_to_complete--;
-                    cout << "Rank " << world_rank << ": Child " << sender_rank << " reported completion. " << children_yet_to_complete << " children left." << endl;
+                    RLOG(LOG_INFO, EV_RECV, "Child {peer} reported completion. {a} children left.", sender_rank, received_tag, 0, children_yet_to_complete);
                 }
             }
             else if (received_tag == MR_REJECT_TAG) {
                 if (level_status == 1) {
                     no_response_remaining--;
-                    cout << "Rank " << world_rank << ": Rejected by " << sender_rank << " (MR). Resp left: " << no_response_remaining << endl;
+                    RLOG(LOG_INFO, EV_RECV, "Rejected by {peer} (MR). Resp left: {a}", sender_rank, received_tag, 0, no_response_remaining);
                 }
             }
             else if (received_tag == MS_SYNC_TAG) {
                 if (world_rank != ROOT_RANK && sender_rank == parent_rank && level_status == 0) {
                     level_status = 3;
-                    cout << "Rank " << world_rank << ": Received MS from parent " << parent_rank << ". STARTING PROPOSALS." << endl;
+                    RLOG(LOG_INFO, EV_RECV, "Received MS from parent {peer}. STARTING PROPOSALS.", parent_rank, received_tag);
                 }
             }
             else if (received_tag == MC_PROPOSE_TAG) {
                 RSTMessage send_mr_msg = {world_rank};
                 if (parent_rank != -2) { 
                     MPI_Send(&send_mr_msg, sizeof(RSTMessage), MPI_BYTE, sender_rank, MR_REJECT_TAG, MPI_COMM_WORLD);
-                    cout << "Rank " << world_rank << ": Rejected late MC proposal from " << sender_rank << " (sent MR)." << endl;
+                    RLOG(LOG_INFO, EV_SEND, "Rejected late MC proposal from {peer} (sent MR).", sender_rank, MR_REJECT_TAG);
                 } 
             }
-            else if (received_tag == M_TERMINATE_TAG) {
-                if (world_rank != ROOT_RANK) {
-                    cout << "Rank " << world_rank << ": Received TERMINATE from ROOT. Shutting down." << endl;
-                    loop_active = false;
-                }
-            }
         }
         if (level_status == 3) {
             RSTMessage send_mc_msg = {world_rank};
@@ -132,7 +181,7 @@ int main(int argc, char** argv) {
             for (int dest_rank : neighbors) {
                 if (dest_rank != parent_rank) {
                     MPI_Send(&send_mc_msg, sizeof(RSTMessage), MPI_BYTE, dest_rank, MC_PROPOSE_TAG, MPI_COMM_WORLD);
-                    cout << "Rank " << world_rank << ": Sent MC to neighbor " << dest_rank << endl;
+                    RLOG(LOG_DEBUG, EV_SEND, "Sent MC to neighbor {peer}", dest_rank, MC_PROPOSE_TAG);
                     proposals_sent++;
                 }
             }
@@ -140,7 +189,7 @@ int main(int argc, char** argv) {
             level_status = 1;             
             
             if (proposals_sent == 0) {
-                cout << "Rank " << world_rank << ": Is a LEAF node. No proposals to send." << endl;
+                RLOG(LOG_INFO, EV_STATE, "Is a LEAF node. No proposals to send.");
                 level_status = 2;
                 children_yet_to_complete = 0;
             }
@@ -148,11 +197,11 @@ int main(int argc, char** argv) {
         if (level_status == 1 && no_response_remaining == 0) {
             level_status = 2;
             children_yet_to_complete = children.size();
-            cout << "Rank " << world_rank << ": Finished proposals. Sending MS_SYNC to " << children_yet_to_complete << " children." << endl;
+            RLOG(LOG_INFO, EV_STATE, "Finished proposals. Sending MS_SYNC to {a} children.", -1, -1, 0, children_yet_to_complete);
             RSTMessage send_ms_msg = {world_rank};
             for(int child_rank : children) {
                 MPI_Send(&send_ms_msg, sizeof(RSTMessage), MPI_BYTE, child_rank, MS_SYNC_TAG, MPI_COMM_WORLD);
-                cout << "Rank " << world_rank << ": Sent MS to child " << child_rank << " to start its proposals." << endl;
+                RLOG(LOG_DEBUG, EV_SEND, "Sent MS to child {peer} to start its proposals.", child_rank, MS_SYNC_TAG);
             }
             if (children_yet_to_complete == 0) {
                 level_status = 4; 
@@ -160,29 +209,38 @@ int main(int argc, char** argv) {
         }
         if (level_status == 2 && children_yet_to_complete == 0) {
              if (world_rank == ROOT_RANK) {
-                cout << "Rank " << world_rank << " (ROOT): All children reported completion. Broadcasting TERMINATE." << endl;
+                RLOG(LOG_INFO, EV_STATE, "(ROOT): All children reported completion. Broadcasting TERMINATE down the tree.");
                 level_status = 5; 
                 loop_active = false;
 
-                RSTMessage terminate_msg = {world_rank};
-                for (int i = 1; i < world_size; ++i) {
-                    MPI_Send(&terminate_msg, sizeof(RSTMessage), MPI_BYTE, i, M_TERMINATE_TAG, MPI_COMM_WORLD);
-                }
+                char terminate = 1;
+                tree.set_tree(-1, children);
+                tree.bcast(&terminate, 1);
              } 
              else level_status = 4; 
         }
         if (level_status == 4) {
             RSTMessage send_complete_msg = {world_rank};
             MPI_Send(&send_complete_msg, sizeof(RSTMessage), MPI_BYTE, parent_rank, MC_COMPLETE_TAG, MPI_COMM_WORLD);
-            cout << "Rank " << world_rank << ": Subtree complete. Sent MC_COMPLETE to parent " << parent_rank << endl;
+            RLOG(LOG_INFO, EV_SEND, "Subtree complete. Sent MC_COMPLETE to parent {peer}", parent_rank, MC_COMPLETE_TAG);
             level_status = 5; 
-            cout << "Rank " << world_rank << ": Moving to state 5 (Finished). Waiting for TERMINATE." << endl;
+            tree.set_tree(parent_rank, children);
+            RLOG(LOG_DEBUG, EV_STATE, "Moving to state 5 (Finished). Waiting for TERMINATE.");
+        }
+        if (level_status == 5 && world_rank != ROOT_RANK && tree.bcast_pending()) {
+            char terminate = 0;
+            tree.bcast(&terminate, 1);
+            RLOG(LOG_INFO, EV_RECV, "Received TERMINATE from parent {peer}, forwarded to {a} children. Shutting down.", parent_rank, -1, 0, children.size());
+            loop_active = false;
         }
     }    
     MPI_Cancel(&recv_request);
     MPI_Status status;
     MPI_Wait(&recv_request, &status);    
-    MPI_Barrier(MPI_COMM_WORLD); 
+    int one = 1, spanned = 0;
+    tree.reduce(&one, &spanned, 1, TREE_SUM);
+    if (world_rank == ROOT_RANK) cout << "Tree reduce: the tree spans " << spanned << " ranks" << endl;
+    tree.barrier();
 
     cout << "\n--- Rank " << world_rank << " BFS Result ---" << endl;
     cout << "Parent: " << ((world_rank == ROOT_RANK) ? "ROOT" : to_string(parent_rank)) << endl;
@@ -193,6 +251,904 @@ int main(int argc, char** argv) {
         cout << endl;
     }
     cout << "--------------------------------" << endl;
-    MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
+
+// ---------------------------------------------------------------------------
+// Level-synchronous BFS over a partitioned CSR graph (csr_graph.h).
+// Every level, the frontier's proposals (target, proposer) are bucketed by the
+// owner of the target and exchanged in one MPI_Alltoallv. A vertex adopts the
+// first proposer it sees as its parent and joins the next frontier, so a
+// level costs one collective instead of one message per edge per tag.
+// Proposals to vertices on the same rank are applied without going through MPI.
+// ---------------------------------------------------------------------------
+
+struct BfsStats {
+    int levels = 0;
+    long long edges_examined = 0;   // adjacency entries scanned, summed over ranks
+    long long reached = 0;
+    long long traversed_edges = 0;  // undirected edges inside the reached component
+    double seconds = 0;
+    string directions;              // one letter per level: T top-down, B bottom-up
+};
+
+// one MPI_Alltoallv of per-destination int64 buckets; the buckets are emptied
+vector<int64_t> exchange_buckets(vector<vector<int64_t>>& outbox, MPI_Comm comm) {
+    int size = outbox.size();
+    vector<int> send_counts(size), recv_counts(size), send_displs(size), recv_displs(size);
+    int send_total = 0;
+    for (int r = 0; r < size; ++r) {
+        send_counts[r] = outbox[r].size();
+        send_displs[r] = send_total;
+        send_total += send_counts[r];
+    }
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    int recv_total = 0;
+    for (int r = 0; r < size; ++r) { recv_displs[r] = recv_total; recv_total += recv_counts[r]; }
+
+    vector<int64_t> send(send_total), recv(recv_total);
+    for (int r = 0; r < size; ++r) {
+        copy(outbox[r].begin(), outbox[r].end(), send.begin() + send_displs[r]);
+        outbox[r].clear();
+    }
+    MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), MPI_INT64_T,
+                  recv.data(), recv_counts.data(), recv_displs.data(), MPI_INT64_T, comm);
+    return recv;
+}
+
+// global totals once a search is over: edges examined, vertices reached and
+// the edges of the reached component
+void finish_stats(const CsrGraph& g, const vector<int64_t>& parent, long long examined, BfsStats& stats, MPI_Comm comm) {
+    long long local[3] = {examined, 0, 0}, global[3];
+    for (int64_t lv = 0; lv < g.local_n; ++lv) {
+        if (parent[lv] < 0) continue;
+        local[1]++;
+        local[2] += g.degree(lv);
+    }
+    MPI_Allreduce(local, global, 3, MPI_LONG_LONG, MPI_SUM, comm);
+    stats.edges_examined = global[0];
+    stats.reached = global[1];
+    stats.traversed_edges = global[2] / 2;
+}
+
+// parent[] is -1 for unreached vertices and the root's own id for the root;
+// level[] is the BFS depth or -1
+BfsStats bfs_level_sync(const CsrGraph& g, int64_t root, vector<int64_t>& parent, vector<int32_t>& level, MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    parent.assign(g.local_n, -1);
+    level.assign(g.local_n, -1);
+
+    BfsStats stats;
+    long long examined = 0;
+    vector<int64_t> frontier, next;
+    vector<vector<int64_t>> outbox(size);
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    if (g.owns(root)) {
+        int64_t lv = g.part.local(root);
+        parent[lv] = root;
+        level[lv] = 0;
+        frontier.push_back(lv);
+    }
+
+    for (int depth = 0;; ++depth) {
+        long long frontier_size = frontier.size(), global_frontier = 0;
+        MPI_Allreduce(&frontier_size, &global_frontier, 1, MPI_LONG_LONG, MPI_SUM, comm);
+        if (global_frontier == 0) break;
+        stats.levels = depth + 1;
+        stats.directions += 'T';
+
+        for (int64_t lv : frontier) {
+            int64_t v = g.global(lv);
+            for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+                int64_t u = g.targets[k];
+                if (u == parent[lv]) continue;
+                examined++;
+                int owner = g.part.owner(u);
+                if (owner == g.rank) {
+                    int64_t lu = g.part.local(u);
+                    if (parent[lu] < 0) {
+                        parent[lu] = v;
+                        level[lu] = depth + 1;
+                        next.push_back(lu);
+                    }
+                }
+                else {
+                    outbox[owner].push_back(u);
+                    outbox[owner].push_back(v);
+                }
+            }
+        }
+
+        vector<int64_t> in = exchange_buckets(outbox, comm);
+        for (size_t k = 0; k + 1 < in.size(); k += 2) {
+            int64_t lu = g.part.local(in[k]);
+            if (parent[lu] < 0) {
+                parent[lu] = in[k + 1];
+                level[lu] = depth + 1;
+                next.push_back(lu);
+            }
+        }
+        frontier.swap(next);
+        next.clear();
+    }
+    stats.seconds = MPI_Wtime() - t0;
+    finish_stats(g, parent, examined, stats, comm);
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// Direction-optimizing BFS (Beamer, Asanovic, Patterson). Top-down levels are
+// the proposal exchange above. Bottom-up levels turn it around: every
+// unvisited local vertex scans its own adjacency for a parent in the frontier,
+// and stops at the first one. The frontier travels as a bitmap, with one bit
+// per vertex, assembled by MPI_Allgatherv from every rank's words. Bottom-up
+// needs no per-edge messages and no rejects.
+// Heuristics, from totals allreduced every level:
+//   top-down -> bottom-up when m_f > m_u / alpha   (frontier edges vs. unexplored edges)
+//   bottom-up -> top-down when n_f < n / beta and the frontier is shrinking
+// ---------------------------------------------------------------------------
+
+const double DO_ALPHA = 14.0;
+const double DO_BETA = 24.0;
+
+inline bool test_bit(const vector<uint64_t>& bits, int64_t i) { return bits[i >> 6] >> (i & 63) & 1; }
+inline void set_bit(vector<uint64_t>& bits, int64_t i) { bits[i >> 6] |= 1ULL << (i & 63); }
+
+BfsStats bfs_direction_optimizing(const CsrGraph& g, int64_t root, vector<int64_t>& parent, vector<int32_t>& level,
+                                  MPI_Comm comm, double alpha = DO_ALPHA, double beta = DO_BETA) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    parent.assign(g.local_n, -1);
+    level.assign(g.local_n, -1);
+
+    // rank r's vertices occupy words [word_displs[r], word_displs[r] + word_counts[r]) of the global frontier
+    vector<int> word_counts(size), word_displs(size);
+    for (int r = 0, sum = 0; r < size; ++r) {
+        word_counts[r] = (g.part.count(r) + 63) / 64;
+        word_displs[r] = sum;
+        sum += word_counts[r];
+    }
+    vector<uint64_t> visited(word_counts[g.rank], 0), local_frontier(word_counts[g.rank], 0);
+    vector<uint64_t> frontier_bits(word_displs[size - 1] + word_counts[size - 1], 0);
+    auto in_frontier = [&](int64_t u) {
+        int r = g.part.owner(u);
+        int64_t lu = g.part.local(u);
+        return frontier_bits[word_displs[r] + (lu >> 6)] >> (lu & 63) & 1;
+    };
+
+    BfsStats stats;
+    long long examined = 0;
+    long long unexplored_edges = 0;
+    for (int64_t lv = 0; lv < g.local_n; ++lv) unexplored_edges += g.degree(lv);
+    vector<int64_t> frontier, next;
+    vector<vector<int64_t>> outbox(size);
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    if (g.owns(root)) {
+        int64_t lv = g.part.local(root);
+        parent[lv] = root;
+        level[lv] = 0;
+        set_bit(visited, lv);
+        unexplored_edges -= g.degree(lv);
+        frontier.push_back(lv);
+    }
+
+    auto discover = [&](int64_t lu, int64_t p, int depth) {
+        parent[lu] = p;
+        level[lu] = depth;
+        set_bit(visited, lu);
+        unexplored_edges -= g.degree(lu);
+        next.push_back(lu);
+    };
+
+    bool bottom_up = false;
+    long long previous_nf = 0;
+    for (int depth = 0;; ++depth) {
+        // n_f, m_f, m_u
+        long long local[3] = {(long long)frontier.size(), 0, unexplored_edges}, global[3];
+        for (int64_t lv : frontier) local[1] += g.degree(lv);
+        MPI_Allreduce(local, global, 3, MPI_LONG_LONG, MPI_SUM, comm);
+        if (global[0] == 0) break;
+        if (!bottom_up && global[1] > global[2] / alpha) bottom_up = true;
+        else if (bottom_up && global[0] < g.part.n / beta && global[0] < previous_nf) bottom_up = false;
+        previous_nf = global[0];
+        stats.levels = depth + 1;
+        stats.directions += bottom_up ? 'B' : 'T';
+
+        if (bottom_up) {
+            fill(local_frontier.begin(), local_frontier.end(), 0);
+            for (int64_t lv : frontier) set_bit(local_frontier, lv);
+            MPI_Allgatherv(local_frontier.data(), word_counts[g.rank], MPI_UINT64_T,
+                           frontier_bits.data(), word_counts.data(), word_displs.data(), MPI_UINT64_T, comm);
+            for (int64_t lv = 0; lv < g.local_n; ++lv) {
+                if (test_bit(visited, lv)) continue;
+                for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+                    examined++;
+                    if (in_frontier(g.targets[k])) {
+                        discover(lv, g.targets[k], depth + 1);
+                        break;
+                    }
+                }
+            }
+        }
+        else {
+            for (int64_t lv : frontier) {
+                int64_t v = g.global(lv);
+                for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+                    int64_t u = g.targets[k];
+                    if (u == parent[lv]) continue;
+                    examined++;
+                    int owner = g.part.owner(u);
+                    if (owner == g.rank) {
+                        int64_t lu = g.part.local(u);
+                        if (!test_bit(visited, lu)) discover(lu, v, depth + 1);
+                    }
+                    else {
+                        outbox[owner].push_back(u);
+                        outbox[owner].push_back(v);
+                    }
+                }
+            }
+            vector<int64_t> in = exchange_buckets(outbox, comm);
+            for (size_t k = 0; k + 1 < in.size(); k += 2) {
+                int64_t lu = g.part.local(in[k]);
+                if (!test_bit(visited, lu)) discover(lu, in[k + 1], depth + 1);
+            }
+        }
+        frontier.swap(next);
+        next.clear();
+    }
+    stats.seconds = MPI_Wtime() - t0;
+    finish_stats(g, parent, examined, stats, comm);
+    return stats;
+}
+
+// Ship (parent, child, child level) to the parent's owner. The owner records
+// the child and checks that the parent sits exactly one level above it.
+// Returns the number of violations over all ranks; children may be null.
+long long collect_children(const CsrGraph& g, int64_t root, const vector<int64_t>& parent, const vector<int32_t>& level,
+                           vector<vector<int64_t>>* children, MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    vector<vector<int64_t>> outbox(size);
+    for (int64_t lv = 0; lv < g.local_n; ++lv) {
+        int64_t v = g.global(lv);
+        if (parent[lv] < 0 || v == root) continue;
+        vector<int64_t>& box = outbox[g.part.owner(parent[lv])];
+        box.push_back(parent[lv]);
+        box.push_back(v);
+        box.push_back(level[lv]);
+    }
+    vector<int64_t> in = exchange_buckets(outbox, comm);
+
+    if (children) children->assign(g.local_n, {});
+    long long errors = 0, global_errors = 0;
+    for (size_t k = 0; k + 2 < in.size(); k += 3) {
+        int64_t lp = g.part.local(in[k]);
+        if (level[lp] < 0 || level[lp] != in[k + 2] - 1) errors++;
+        if (children) (*children)[lp].push_back(in[k + 1]);
+    }
+    if (g.owns(root) && (level[g.part.local(root)] != 0)) errors++;
+    MPI_Allreduce(&errors, &global_errors, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    return global_errors;
+}
+
+// the 4-cycle of the original protocol, used when no edge-list file is given
+vector<HalfEdge> builtin_edges() {
+    return {{0, 1, 1}, {1, 2, 1}, {2, 3, 1}, {3, 0, 1}};
+}
+
+int run_level_sync(int rank, int size, const string& path, int64_t root, bool direction_optimizing) {
+    CsrGraph g;
+    if (path.empty()) {
+        vector<HalfEdge> edges = rank == 0 ? builtin_edges() : vector<HalfEdge>();
+        g = build_csr_graph(MPI_COMM_WORLD, edges, 4, false);
+    }
+    else if (!load_csr_graph(MPI_COMM_WORLD, path, g)) {
+        if (rank == 0) cerr << "Error: cannot read edge list " << path << endl;
+        return 1;
+    }
+    if (root < 0 || root >= g.part.n) {
+        if (rank == 0) cerr << "Error: root " << root << " is not a vertex of the graph" << endl;
+        return 1;
+    }
+
+    vector<int64_t> parent;
+    vector<int32_t> level;
+    BfsStats stats = direction_optimizing ? bfs_direction_optimizing(g, root, parent, level, MPI_COMM_WORLD)
+                                          : bfs_level_sync(g, root, parent, level, MPI_COMM_WORLD);
+    vector<vector<int64_t>> children;
+    const bool small = g.part.n <= PRINT_LIMIT;
+    long long errors = collect_children(g, root, parent, level, small ? &children : nullptr, MPI_COMM_WORLD);
+
+    if (small) {
+        for (int r = 0; r < size; ++r) {
+            if (rank == r) {
+                for (int64_t lv = 0; lv < g.local_n; ++lv) {
+                    int64_t v = g.global(lv);
+                    cout << "\n--- Vertex " << v << " (Rank " << rank << ") BFS Result ---" << endl;
+                    if (v == root) cout << "Parent: ROOT" << endl;
+                    else if (parent[lv] < 0) cout << "Parent: unreachable" << endl;
+                    else cout << "Parent: " << parent[lv] << endl;
+                    cout << "Children (" << children[lv].size() << "): ";
+                    if (children[lv].empty()) cout << "None" << endl;
+                    else {
+                        for (int64_t c : children[lv]) cout << c << " ";
+                        cout << endl;
+                    }
+                    cout << "--------------------------------" << endl;
+                }
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+    }
+
+    if (rank == 0) {
+        cout << fixed << setprecision(4);
+        cout << (direction_optimizing ? "Direction-optimizing" : "Level-synchronous") << " BFS from " << root << ": " << g.part.n << " vertices, " << g.global_edges
+             << " edges on " << size << " ranks" << endl;
+        cout << "  levels " << stats.levels << " (" << stats.directions << "), reached " << stats.reached << ", edges examined " << stats.edges_examined
+             << ", time " << stats.seconds << " s, " << setprecision(2) << stats.traversed_edges / stats.seconds / 1e6
+             << " MTEPS, tree check " << (errors == 0 ? "ok" : "FAILED (" + to_string(errors) + ")") << endl;
+    }
+    return errors == 0 ? 0 : 1;
+}
+
+// the benchmark graph: Kronecker edges generated in parallel, then shuffled into the CSR
+CsrGraph build_kronecker_graph(int rank, int size, int scale, int edgefactor, const char* title) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+    vector<HalfEdge> edges = generate_kronecker_edges(scale, edgefactor, rank, size, GRAPH500_SEED);
+    double gen_time = MPI_Wtime() - t0;
+    CsrGraph g = build_csr_graph(MPI_COMM_WORLD, edges, (int64_t)1 << scale, false);
+    vector<HalfEdge>().swap(edges);
+    double build_time = MPI_Wtime() - t0 - gen_time;
+
+    if (rank == 0) {
+        cout << title << ": scale " << scale << ", edgefactor " << edgefactor << " -> " << g.part.n << " vertices, "
+             << g.global_edges << " unique edges on " << size << " ranks" << endl;
+        cout << fixed << setprecision(3) << "  generation " << gen_time << " s, CSR construction " << build_time << " s" << endl;
+    }
+    return g;
+}
+
+// random roots of non-zero degree, the same sequence on every rank
+vector<int64_t> pick_roots(const CsrGraph& g, int count) {
+    mt19937_64 rng(GRAPH500_SEED + 1);
+    vector<int64_t> roots;
+    for (int attempts = 0; (int)roots.size() < count && attempts < 64 * count; ++attempts) {
+        int64_t root = rng() % g.part.n;
+        long long degree = g.owns(root) ? g.degree(g.part.local(root)) : 0, root_degree = 0;
+        MPI_Allreduce(&degree, &root_degree, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        if (root_degree > 0) roots.push_back(root);
+    }
+    return roots;
+}
+
+double harmonic_mean(const vector<double>& values) {
+    double inverse_sum = 0;
+    for (double v : values) inverse_sum += 1.0 / v;
+    return values.empty() ? 0 : values.size() / inverse_sum;
+}
+
+// Graph500-style benchmark: build a Kronecker graph, run BFS from several
+// random roots of non-zero degree and report TEPS (traversed edges of the
+// root's component per second) with the harmonic mean, as Graph500 does.
+void run_graph500(int rank, int size, int scale, int edgefactor, int roots) {
+    CsrGraph g = build_kronecker_graph(rank, size, scale, edgefactor, "Graph500 BFS");
+    if (rank == 0) {
+        cout << setw(10) << "root" << setw(8) << "levels" << setw(12) << "reached" << setw(14) << "edges"
+             << setw(11) << "time(s)" << setw(10) << "MTEPS" << setw(8) << "check" << endl;
+    }
+
+    vector<double> teps;
+    long long failures = 0;
+    vector<int64_t> parent;
+    vector<int32_t> level;
+    for (int64_t root : pick_roots(g, roots)) {
+        BfsStats stats = bfs_level_sync(g, root, parent, level, MPI_COMM_WORLD);
+        long long errors = collect_children(g, root, parent, level, nullptr, MPI_COMM_WORLD);
+        failures += errors != 0;
+        teps.push_back(stats.traversed_edges / stats.seconds);
+        if (rank == 0) {
+            cout << setw(10) << root << setw(8) << stats.levels << setw(12) << stats.reached << setw(14) << stats.traversed_edges
+                 << setw(11) << setprecision(4) << stats.seconds << setw(10) << setprecision(2) << teps.back() / 1e6
+                 << setw(8) << (errors == 0 ? "ok" : "FAIL") << endl;
+        }
+    }
+
+    if (rank == 0 && !teps.empty()) {
+        sort(teps.begin(), teps.end());
+        cout << setprecision(2) << "  TEPS (millions): min " << teps.front() / 1e6 << ", median " << teps[teps.size() / 2] / 1e6
+             << ", max " << teps.back() / 1e6 << ", harmonic mean " << harmonic_mean(teps) / 1e6
+             << "; " << failures << " failed tree checks" << endl;
+    }
+}
+
+// Top-down proposals vs. direction-optimizing BFS from the same roots on the
+// same Kronecker graph: edges examined, wasted proposals (those that would be
+// rejected), wall time and TEPS.
+void run_direction_benchmark(int rank, int size, int scale, int edgefactor, int roots, double alpha, double beta) {
+    CsrGraph g = build_kronecker_graph(rank, size, scale, edgefactor, "Top-down vs. direction-optimizing BFS");
+    if (rank == 0) {
+        cout << "  alpha " << alpha << ", beta " << beta << endl;
+        cout << setw(10) << "root" << setw(14) << "engine" << setw(12) << "levels" << setw(14) << "examined"
+             << setw(14) << "wasted" << setw(11) << "time(s)" << setw(10) << "MTEPS" << setw(8) << "check" << endl;
+    }
+
+    const char* names[2] = {"top-down", "direction-opt"};
+    vector<double> teps[2];
+    long long examined[2] = {0, 0};
+    double seconds[2] = {0, 0};
+    vector<int64_t> parent;
+    vector<int32_t> level;
+    for (int64_t root : pick_roots(g, roots)) {
+        for (int engine = 0; engine < 2; ++engine) {
+            BfsStats stats = engine == 0 ? bfs_level_sync(g, root, parent, level, MPI_COMM_WORLD)
+                                         : bfs_direction_optimizing(g, root, parent, level, MPI_COMM_WORLD, alpha, beta);
+            long long errors = collect_children(g, root, parent, level, nullptr, MPI_COMM_WORLD);
+            teps[engine].push_back(stats.traversed_edges / stats.seconds);
+            examined[engine] += stats.edges_examined;
+            seconds[engine] += stats.seconds;
+            if (rank == 0) {
+                cout << setw(10) << root << setw(14) << names[engine] << setw(12) << stats.directions
+                     << setw(14) << stats.edges_examined << setw(14) << stats.edges_examined - (stats.reached - 1)
+                     << setw(11) << setprecision(4) << stats.seconds << setw(10) << setprecision(2) << teps[engine].back() / 1e6
+                     << setw(8) << (errors == 0 ? "ok" : "FAIL") << endl;
+            }
+        }
+    }
+
+    if (rank == 0 && !teps[0].empty()) {
+        for (int engine = 0; engine < 2; ++engine) {
+            cout << "  " << setw(14) << left << names[engine] << right << " edges examined " << examined[engine]
+                 << ", total time " << setprecision(4) << seconds[engine] << " s, harmonic mean "
+                 << setprecision(2) << harmonic_mean(teps[engine]) / 1e6 << " MTEPS" << endl;
+        }
+        cout << "  direction-optimizing examined " << setprecision(1) << 100.0 * examined[1] / max(1LL, examined[0])
+             << "% of the top-down edges, speedup " << setprecision(2) << seconds[0] / seconds[1] << "x" << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Hybrid MPI + threads BFS. The ranks still own block partitions and exchange
+// each level with one MPI_Alltoallv. Inside a rank, the frontier and the
+// received proposals are expanded by a work-stealing thread pool. A vertex is
+// claimed with a compare-and-swap on its parent, and only edges leaving the
+// partition become MPI traffic. Only the calling thread makes MPI calls.
+// ---------------------------------------------------------------------------
+
+const int64_t HYBRID_GRAIN = 256;   // frontier vertices or proposals per stolen chunk
+
+struct alignas(64) HybridWorker {
+    vector<vector<int64_t>> outbox;
+    vector<int64_t> next;
+    long long examined = 0;
+};
+
+BfsStats bfs_hybrid(const CsrGraph& g, int64_t root, vector<int64_t>& parent, vector<int32_t>& level,
+                    WorkStealingPool& pool, MPI_Comm comm) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    vector<atomic<int64_t>> claim(g.local_n);
+    for (auto& c : claim) c.store(-1, memory_order_relaxed);
+    level.assign(g.local_n, -1);
+    vector<HybridWorker> workers(pool.size());
+    for (auto& w : workers) w.outbox.assign(size, {});
+
+    auto try_claim = [&](int64_t lu, int64_t p, int depth, HybridWorker& w) {
+        int64_t expected = -1;
+        if (claim[lu].load(memory_order_relaxed) >= 0 ||
+            !claim[lu].compare_exchange_strong(expected, p, memory_order_relaxed)) return;
+        level[lu] = depth;
+        w.next.push_back(lu);
+    };
+
+    BfsStats stats;
+    vector<int64_t> frontier;
+    vector<vector<int64_t>> outbox(size);
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    if (g.owns(root)) {
+        int64_t lv = g.part.local(root);
+        claim[lv].store(root, memory_order_relaxed);
+        level[lv] = 0;
+        frontier.push_back(lv);
+    }
+
+    for (int depth = 0;; ++depth) {
+        long long frontier_size = frontier.size(), global_frontier = 0;
+        MPI_Allreduce(&frontier_size, &global_frontier, 1, MPI_LONG_LONG, MPI_SUM, comm);
+        if (global_frontier == 0) break;
+        stats.levels = depth + 1;
+        stats.directions += 'T';
+
+        pool.parallel_for(0, frontier.size(), HYBRID_GRAIN, [&](int id, int64_t lo, int64_t hi) {
+            HybridWorker& w = workers[id];
+            for (int64_t i = lo; i < hi; ++i) {
+                int64_t lv = frontier[i], v = g.global(lv), p = claim[lv].load(memory_order_relaxed);
+                for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+                    int64_t u = g.targets[k];
+                    if (u == p) continue;
+                    w.examined++;
+                    int owner = g.part.owner(u);
+                    if (owner == g.rank) try_claim(g.part.local(u), v, depth + 1, w);
+                    else {
+                        w.outbox[owner].push_back(u);
+                        w.outbox[owner].push_back(v);
+                    }
+                }
+            }
+        });
+
+        for (auto& w : workers) {
+            for (int r = 0; r < size; ++r) {
+                outbox[r].insert(outbox[r].end(), w.outbox[r].begin(), w.outbox[r].end());
+                w.outbox[r].clear();
+            }
+        }
+        vector<int64_t> in = exchange_buckets(outbox, comm);
+        pool.parallel_for(0, in.size() / 2, HYBRID_GRAIN, [&](int id, int64_t lo, int64_t hi) {
+            for (int64_t k = lo; k < hi; ++k) try_claim(g.part.local(in[2 * k]), in[2 * k + 1], depth + 1, workers[id]);
+        });
+
+        frontier.clear();
+        for (auto& w : workers) {
+            frontier.insert(frontier.end(), w.next.begin(), w.next.end());
+            w.next.clear();
+        }
+    }
+    stats.seconds = MPI_Wtime() - t0;
+
+    parent.resize(g.local_n);
+    for (int64_t lv = 0; lv < g.local_n; ++lv) parent[lv] = claim[lv].load(memory_order_relaxed);
+    long long examined = 0;
+    for (auto& w : workers) examined += w.examined;
+    finish_stats(g, parent, examined, stats, comm);
+    return stats;
+}
+
+// Strong scaling on one node: the same Kronecker graph and roots with 1, 2,
+// 4, ... threads per rank. Running it under several -np values fills in the
+// threads x ranks grid.
+void run_hybrid_benchmark(int rank, int size, int scale, int edgefactor, int roots, int max_threads) {
+    CsrGraph g = build_kronecker_graph(rank, size, scale, edgefactor, "Hybrid MPI + threads BFS");
+    vector<int64_t> root_list = pick_roots(g, roots);
+    if (rank == 0) {
+        cout << setw(8) << "ranks" << setw(9) << "threads" << setw(8) << "cores" << setw(12) << "time(s)"
+             << setw(12) << "MTEPS" << setw(10) << "speedup" << setw(10) << "steals" << setw(8) << "check" << endl;
+    }
+
+    vector<int64_t> parent;
+    vector<int32_t> level;
+    double base = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        WorkStealingPool pool(threads);
+        vector<double> teps;
+        double seconds = 0;
+        long long failures = 0;
+        for (int64_t root : root_list) {
+            BfsStats stats = bfs_hybrid(g, root, parent, level, pool, MPI_COMM_WORLD);
+            failures += collect_children(g, root, parent, level, nullptr, MPI_COMM_WORLD) != 0;
+            teps.push_back(stats.traversed_edges / stats.seconds);
+            seconds += stats.seconds;
+        }
+        long long steals = pool.steals(), total_steals = 0;
+        MPI_Reduce(&steals, &total_steals, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (threads == 1) base = seconds;
+        if (rank == 0) {
+            cout << setw(8) << size << setw(9) << threads << setw(8) << size * threads
+                 << setw(12) << setprecision(4) << seconds / max<size_t>(1, root_list.size())
+                 << setw(12) << setprecision(2) << harmonic_mean(teps) / 1e6 << setw(9) << base / seconds << "x"
+                 << setw(10) << total_steals << setw(8) << (failures == 0 ? "ok" : "FAIL") << endl;
+        }
+    }
+}
+
+// Tree collectives against MPI's own on the same ranks. The tree is a BFS tree
+// from rank 0 over a rank graph (a ring plus one pseudo-random chord per rank),
+// built with bfs_level_sync on a CSR graph with one vertex per rank.
+void run_collectives_benchmark(int rank, int size, size_t max_bytes, size_t chunk_bytes) {
+    vector<HalfEdge> edges;
+    if (size > 1) edges.push_back({rank, (rank + 1) % size, 1});
+    if (size > 3) edges.push_back({rank, (int64_t)((rank * 7919ULL + 13) % size), 1});
+    CsrGraph g = build_csr_graph(MPI_COMM_WORLD, edges, size, false);
+    vector<int64_t> parent;
+    vector<int32_t> level;
+    BfsStats stats = bfs_level_sync(g, 0, parent, level, MPI_COMM_WORLD);
+    vector<vector<int64_t>> tree_children;
+    collect_children(g, 0, parent, level, &tree_children, MPI_COMM_WORLD);
+
+    TreeCollectives tree(MPI_COMM_WORLD, chunk_bytes);
+    vector<int> children(tree_children[0].begin(), tree_children[0].end());
+    tree.set_tree(rank == 0 ? -1 : (int)parent[0], children);
+
+    int fan_out = children.size(), max_fan_out = 0;
+    MPI_Reduce(&fan_out, &max_fan_out, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        cout << "Tree collectives vs. MPI on " << size << " ranks: BFS tree of depth " << stats.levels - 1
+             << ", max fan-out " << max_fan_out << ", chunk " << chunk_bytes << " B" << endl;
+        cout << setw(10) << "bytes" << setw(14) << "tree bcast" << setw(14) << "MPI_Bcast" << setw(14) << "tree reduce"
+             << setw(14) << "MPI_Reduce" << setw(8) << "check" << "   (us per call, max over ranks)" << endl;
+    }
+
+    // time reps calls of op, return the slowest rank's average in microseconds
+    auto time_op = [&](int reps, const function<void()>& op) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        for (int i = 0; i < reps; ++i) op();
+        double t = (MPI_Wtime() - t0) / reps * 1e6, worst = 0;
+        MPI_Allreduce(&t, &worst, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        return worst;
+    };
+
+    for (size_t bytes = 8; bytes <= max_bytes; bytes *= 8) {
+        int reps = (int)max<size_t>(5, min<size_t>(200, (4u << 20) / bytes));
+        size_t count = bytes / sizeof(double);
+        vector<double> data(count), tree_out(count), mpi_out(count);
+        for (size_t i = 0; i < count; ++i) data[i] = rank + i * 0.5;
+
+        double tree_bcast = time_op(reps, [&] { tree.bcast(data.data(), bytes); });
+        double mpi_bcast = time_op(reps, [&] { MPI_Bcast(data.data(), (int)bytes, MPI_BYTE, 0, MPI_COMM_WORLD); });
+        for (size_t i = 0; i < count; ++i) data[i] = rank + i * 0.5;
+        double tree_reduce = time_op(reps, [&] { tree.reduce(data.data(), tree_out.data(), count, TREE_SUM); });
+        double mpi_reduce = time_op(reps, [&] { MPI_Reduce(data.data(), mpi_out.data(), (int)count, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD); });
+
+        int ok = 1;
+        if (rank == 0)
+            for (size_t i = 0; i < count; ++i) ok &= fabs(tree_out[i] - mpi_out[i]) <= 1e-9 * max(1.0, fabs(mpi_out[i]));
+        if (rank == 0) {
+            cout << fixed << setprecision(1) << setw(10) << bytes << setw(14) << tree_bcast << setw(14) << mpi_bcast
+                 << setw(14) << tree_reduce << setw(14) << mpi_reduce << setw(8) << (ok ? "ok" : "FAIL") << endl;
+        }
+    }
+
+    double tree_barrier = time_op(200, [&] { tree.barrier(); });
+    double mpi_barrier = time_op(200, [&] { MPI_Barrier(MPI_COMM_WORLD); });
+    int in[2] = {rank, -rank}, mins[2] = {0, 0}, maxs[2] = {0, 0};
+    tree.allreduce(in, mins, 2, TREE_MIN);
+    tree.allreduce(in, maxs, 2, TREE_MAX);
+    if (rank == 0) {
+        cout << setw(10) << "barrier" << setw(14) << tree_barrier << setw(14) << mpi_barrier << endl;
+        cout << "  allreduce min/max of ranks: " << mins[0] << "/" << maxs[0]
+             << ((mins[0] == 0 && maxs[0] == size - 1 && mins[1] == -(size - 1) && maxs[1] == 0) ? " (ok)" : " (FAIL)") << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// The rank-level BFS of the sync protocol, level-synchronous, over an
+// MPI_Dist_graph_create_adjacent communicator. Each level, every rank hands one
+// int per neighbour to MPI_Neighbor_alltoall: its world rank if it is on the
+// frontier, -1 otherwise. A rank without a parent adopts the smallest proposer
+// and answers every proposer (1 accept / 0 reject) through
+// MPI_Ineighbor_alltoallv, which only carries a value on the edges that
+// proposed; the frontier Iallreduce overlaps it. With reorder = 1 the runtime
+// may renumber ranks so that graph neighbours land on nearby cores, so
+// messages carry world ranks and parents stay comparable across runs.
+// The point-to-point baseline runs the same levels with one Isend/Irecv pair
+// per neighbour on MPI_COMM_WORLD.
+
+struct RankTree {
+    int parent = -2;     // world rank, -1 at the root
+    int levels = 0;
+};
+
+RankTree rank_bfs_neighbor(MPI_Comm graph_comm, int world_rank) {
+    int indegree, outdegree, weighted;
+    MPI_Dist_graph_neighbors_count(graph_comm, &indegree, &outdegree, &weighted);
+    vector<int> sources(indegree), destinations(outdegree);
+    MPI_Dist_graph_neighbors(graph_comm, indegree, sources.data(), MPI_UNWEIGHTED, outdegree, destinations.data(), MPI_UNWEIGHTED);
+
+    RankTree t;
+    bool frontier = world_rank == ROOT_RANK;
+    if (frontier) t.parent = -1;
+    vector<int> proposals(outdegree), proposers(indegree), replies(indegree), answers(outdegree);
+    vector<int> send_counts(indegree), send_displs(indegree), recv_counts(outdegree), recv_displs(outdegree);
+    for (int i = 0; i < indegree; ++i) send_displs[i] = i;
+    for (int i = 0; i < outdegree; ++i) recv_displs[i] = i;
+
+    while (true) {
+        for (int i = 0; i < outdegree; ++i) proposals[i] = frontier ? world_rank : -1;
+        MPI_Neighbor_alltoall(proposals.data(), 1, MPI_INT, proposers.data(), 1, MPI_INT, graph_comm);
+
+        bool adopted = false;
+        if (t.parent == -2) {
+            for (int p : proposers)
+                if (p >= 0 && (t.parent < 0 || p < t.parent)) t.parent = p;
+            adopted = t.parent >= 0;
+        }
+        for (int i = 0; i < indegree; ++i) {
+            send_counts[i] = proposers[i] >= 0;
+            replies[i] = adopted && proposers[i] == t.parent;
+        }
+        for (int i = 0; i < outdegree; ++i) recv_counts[i] = proposals[i] >= 0;
+
+        MPI_Request requests[2];
+        MPI_Ineighbor_alltoallv(replies.data(), send_counts.data(), send_displs.data(), MPI_INT,
+                                answers.data(), recv_counts.data(), recv_displs.data(), MPI_INT, graph_comm, &requests[0]);
+        int next = adopted, any_next = 0;
+        MPI_Iallreduce(&next, &any_next, 1, MPI_INT, MPI_MAX, graph_comm, &requests[1]);
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+
+        t.levels++;
+        if (!any_next) break;
+        frontier = adopted;
+    }
+    return t;
+}
+
+RankTree rank_bfs_p2p(const vector<int>& neighbors, int world_rank) {
+    const int degree = neighbors.size();
+    RankTree t;
+    bool frontier = world_rank == ROOT_RANK;
+    if (frontier) t.parent = -1;
+    vector<int> proposals(degree), proposers(degree), replies(degree), answers(degree);
+    vector<MPI_Request> requests;
+    requests.reserve(2 * degree + 1);
+
+    while (true) {
+        requests.clear();
+        for (int i = 0; i < degree; ++i) {
+            proposals[i] = frontier ? world_rank : -1;
+            requests.emplace_back();
+            MPI_Irecv(&proposers[i], 1, MPI_INT, neighbors[i], MC_PROPOSE_TAG, MPI_COMM_WORLD, &requests.back());
+            requests.emplace_back();
+            MPI_Isend(&proposals[i], 1, MPI_INT, neighbors[i], MC_PROPOSE_TAG, MPI_COMM_WORLD, &requests.back());
+        }
+        MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+        bool adopted = false;
+        if (t.parent == -2) {
+            for (int p : proposers)
+                if (p >= 0 && (t.parent < 0 || p < t.parent)) t.parent = p;
+            adopted = t.parent >= 0;
+        }
+        requests.clear();
+        for (int i = 0; i < degree; ++i) {
+            if (proposals[i] >= 0) {
+                requests.emplace_back();
+                MPI_Irecv(&answers[i], 1, MPI_INT, neighbors[i], MP_ACCEPT_TAG, MPI_COMM_WORLD, &requests.back());
+            }
+            if (proposers[i] >= 0) {
+                replies[i] = adopted && proposers[i] == t.parent;
+                requests.emplace_back();
+                MPI_Isend(&replies[i], 1, MPI_INT, neighbors[i], MP_ACCEPT_TAG, MPI_COMM_WORLD, &requests.back());
+            }
+        }
+        int next = adopted, any_next = 0;
+        requests.emplace_back();
+        MPI_Iallreduce(&next, &any_next, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD, &requests.back());
+        MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+        t.levels++;
+        if (!any_next) break;
+        frontier = adopted;
+    }
+    return t;
+}
+
+int run_neighbor_benchmark(int world_rank, int world_size, const string& topology, int reps) {
+    const vector<vector<int>> adjacency_list = get_graph_topology(world_size, topology);
+    if (adjacency_list.empty()) {
+        if (world_rank == 0) cerr << "Error: topology '" << topology << "' is unreadable or not connected for size " << world_size << endl;
+        return 1;
+    }
+    const vector<int>& neighbors = adjacency_list[world_rank];
+    const int degree = neighbors.size();
+
+    MPI_Comm placed, unplaced;
+    MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD, degree, neighbors.data(), MPI_UNWEIGHTED, degree, neighbors.data(),
+                                   MPI_UNWEIGHTED, MPI_INFO_NULL, 1, &placed);
+    MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD, degree, neighbors.data(), MPI_UNWEIGHTED, degree, neighbors.data(),
+                                   MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &unplaced);
+    int placed_rank, moved = 0, total_moved = 0;
+    MPI_Comm_rank(placed, &placed_rank);
+    moved = placed_rank != world_rank;
+    MPI_Reduce(&moved, &total_moved, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+    long long edges = degree, total_edges = 0;
+    MPI_Reduce(&edges, &total_edges, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (world_rank == 0) {
+        cout << "Rank-level BFS on " << world_size << " ranks, topology '" << topology << "' (" << total_edges / 2
+             << " links), " << reps << " runs per method" << endl;
+        cout << "  reorder = 1 moved " << total_moved << " of " << world_size << " ranks" << endl;
+        cout << setw(22) << "method" << setw(8) << "levels" << setw(14) << "us per BFS" << setw(14) << "us per level"
+             << setw(8) << "check" << "   (max over ranks)" << endl;
+    }
+
+    // run a method reps times; its parents are compared with the point-to-point ones
+    vector<int> reference;
+    auto bench = [&](const char* name, const function<RankTree()>& bfs) {
+        RankTree t = bfs();
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        for (int i = 0; i < reps; ++i) t = bfs();
+        double us = (MPI_Wtime() - t0) / reps * 1e6, worst = 0;
+        MPI_Reduce(&us, &worst, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        vector<int> parents(world_size);
+        MPI_Allgather(&t.parent, 1, MPI_INT, parents.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        if (reference.empty()) reference = parents;
+        if (world_rank == 0) {
+            cout << fixed << setprecision(1) << setw(22) << name << setw(8) << t.levels << setw(14) << worst
+                 << setw(14) << worst / t.levels << setw(8) << (parents == reference ? "ok" : "FAIL") << endl;
+        }
+    };
+    bench("point-to-point", [&] { return rank_bfs_p2p(neighbors, world_rank); });
+    bench("neighbor reorder=0", [&] { return rank_bfs_neighbor(unplaced, world_rank); });
+    bench("neighbor reorder=1", [&] { return rank_bfs_neighbor(placed, world_rank); });
+
+    if (world_rank == 0 && world_size <= PRINT_LIMIT) {
+        for (int r = 0; r < world_size; ++r) {
+            cout << "\n--- Rank " << r << " BFS Result ---" << endl;
+            cout << "Parent: " << (reference[r] < 0 ? "ROOT" : to_string(reference[r])) << endl;
+            vector<int> children;
+            for (int c = 0; c < world_size; ++c)
+                if (reference[c] == r) children.push_back(c);
+            cout << "Children (" << children.size() << "): ";
+            if (children.empty()) cout << "None" << endl;
+            else {
+                for (int c : children) cout << c << " ";
+                cout << endl;
+            }
+            cout << "--------------------------------" << endl;
+        }
+    }
+    MPI_Comm_free(&placed);
+    MPI_Comm_free(&unplaced);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    int world_size;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    string mode = argc > 1 ? argv[1] : "sync";
+    int status = 0;
+    if (mode == "level") {
+        status = run_level_sync(world_rank, world_size, argc > 2 ? argv[2] : "", argc > 3 ? atoll(argv[3]) : 0,
+                                argc > 4 && string(argv[4]) == "do");
+    }
+    else if (mode == "graph500") {
+        run_graph500(world_rank, world_size, argc > 2 ? atoi(argv[2]) : 16, argc > 3 ? atoi(argv[3]) : 16,
+                     argc > 4 ? atoi(argv[4]) : 8);
+    }
+    else if (mode == "direction") {
+        run_direction_benchmark(world_rank, world_size, argc > 2 ? atoi(argv[2]) : 16, argc > 3 ? atoi(argv[3]) : 16,
+                                argc > 4 ? atoi(argv[4]) : 8, argc > 5 ? atof(argv[5]) : DO_ALPHA,
+                                argc > 6 ? atof(argv[6]) : DO_BETA);
+    }
+    else if (mode == "hybrid") {
+        int cores = max(1u, thread::hardware_concurrency());
+        run_hybrid_benchmark(world_rank, world_size, argc > 2 ? atoi(argv[2]) : 16, argc > 3 ? atoi(argv[3]) : 16,
+                             argc > 4 ? atoi(argv[4]) : 4, argc > 5 ? atoi(argv[5]) : max(1, cores / world_size));
+    }
+    else if (mode == "collectives") {
+        run_collectives_benchmark(world_rank, world_size, argc > 2 ? atoll(argv[2]) : (4 << 20),
+                                  argc > 3 ? atoll(argv[3]) : TreeCollectives::DEFAULT_CHUNK);
+    }
+    else if (mode == "sync") {
+        status = run_sync_protocol(world_rank, world_size, argc > 2 ? argv[2] : "ring");
+    }
+    else if (mode == "neighbor") {
+        status = run_neighbor_benchmark(world_rank, world_size, argc > 2 ? argv[2] : "ring", argc > 3 ? atoi(argv[3]) : 100);
+    }
+    else {
+        if (world_rank == 0) cerr << "usage: bfs_async [sync [topology] | neighbor [topology] [reps] | level [edge-list file] [root] [td|do] | graph500 [scale] [edgefactor] [roots] | "
+                                  "direction [scale] [edgefactor] [roots] [alpha] [beta] | hybrid [scale] [edgefactor] [roots] [max threads] | "
+                                  "collectives [max bytes] [chunk bytes]]" << endl;
+        status = 1;
+    }
+
+    MPI_Finalize();
+    return status;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Birman-Schiper-Stephenson causal broadcast on top of a vector clock.
+// delivered[j] counts broadcasts delivered from j. A message from j with
+// clock m is deliverable once m[j] == delivered[j] + 1 and m[k] <= delivered[k]
+// for every other k.
+//
+// MPI keeps messages from one sender in order, so the hold-back queue is a
+// FIFO per sender and only its head can become deliverable. A blocked head is
+// parked on the one entry k it is waiting for, keyed by the value it needs,
+// and is re-checked only when delivered[k] reaches that value. The dependency
+// scan resumes where it stopped, since delivered[] never decreases. Deciding
+// what to deliver therefore never rescans the queue.
+
+#include <deque>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+class CausalBroadcast {
+public:
+    struct Message {
+        int sender;
+        std::vector<int> vc;
+        std::vector<int> payload;
+        int scan_from = 0;     // entries before this are already satisfied
+    };
+
+    using DeliverFn = std::function<void(const Message&)>;
+
+    CausalBroadcast(int rank, int size, DeliverFn deliver)
+        : rank_(rank), delivered_(size, 0), held_(size), waiting_on_(size), deliver_(deliver) {}
+
+    // stamp a new broadcast from this rank; the sender delivers it to itself at once
+    const std::vector<int>& stamp() {
+        delivered_[rank_]++;
+        return delivered_;
+    }
+
+    void receive(int sender, const int* vc, const int* payload, int payload_len) {
+        Message m;
+        m.sender = sender;
+        m.vc.assign(vc, vc + delivered_.size());
+        m.payload.assign(payload, payload + payload_len);
+        held_[sender].push_back(std::move(m));
+        held_count_++;
+        if (held_[sender].size() == 1) drain(sender);
+    }
+
+    const std::vector<int>& delivered() const { return delivered_; }
+    size_t held() const { return held_count_; }
+    size_t held_from(int sender) const { return held_[sender].size(); }
+
+private:
+    // index of the first entry still blocking head, or -1 if deliverable
+    int blocking_entry(Message& head) {
+        const int n = delivered_.size();
+        for (int k = head.scan_from; k < n; ++k) {
+            int needed = (k == head.sender) ? head.vc[k] - 1 : head.vc[k];
+            if (needed > delivered_[k]) {
+                head.scan_from = k;
+                return k;
+            }
+        }
+        head.scan_from = n;
+        return -1;
+    }
+
+    void drain(int first) {
+        std::vector<int> work = {first};
+        while (!work.empty()) {
+            int j = work.back();
+            work.pop_back();
+
+            while (!held_[j].empty()) {
+                Message& head = held_[j].front();
+                int k = blocking_entry(head);
+                if (k >= 0) {
+                    int needed = (k == j) ? head.vc[k] - 1 : head.vc[k];
+                    waiting_on_[k].push({needed, j});
+                    break;
+                }
+
+                delivered_[j]++;
+                deliver_(head);
+                held_[j].pop_front();
+                held_count_--;
+
+                // wake heads that were waiting for this entry to reach its new value
+                auto& waiters = waiting_on_[j];
+                while (!waiters.empty() && waiters.top().first <= delivered_[j]) {
+                    work.push_back(waiters.top().second);
+                    waiters.pop();
+                }
+            }
+        }
+    }
+
+    using Waiter = std::pair<int, int>;   // (value needed, sender whose head waits)
+
+    int rank_;
+    std::vector<int> delivered_;
+    std::vector<std::deque<Message>> held_;
+    std::vector<std::priority_queue<Waiter, std::vector<Waiter>, std::greater<Waiter>>> waiting_on_;
+    size_t held_count_ = 0;
+    DeliverFn deliver_;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+// SIMD kernels shared by the vector and matrix clock programs.
+// AVX2 is used when compiled with -mavx2 / -march=native, SSE2 otherwise,
+// with a scalar tail. Fixed-width VectorClock<N> instantiates the same
+// kernels with a constant count so the compiler can fully unroll them.
+// Loads and stores are unaligned, so any int buffer works, including the
+// std::vector clocks that the runtime dispatch is handed.
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+enum ClockOrder { CLOCK_EQUAL, CLOCK_BEFORE, CLOCK_AFTER, CLOCK_CONCURRENT };
+
+// element-wise dst = max(dst, src), returns true if any element of dst grew
+inline bool clock_max_merge(int* dst, const int* src, size_t count) {
+    size_t k = 0;
+    bool changed = false;
+#if defined(__AVX2__)
+    __m256i grew = _mm256_setzero_si256();
+    for (; k < (count & ~size_t(7)); k += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(dst + k));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + k));
+        grew = _mm256_or_si256(grew, _mm256_cmpgt_epi32(b, a));
+        _mm256_storeu_si256((__m256i*)(dst + k), _mm256_max_epi32(a, b));
+    }
+    changed = !_mm256_testz_si256(grew, grew);
+#elif defined(__SSE2__)
+    __m128i grew = _mm_setzero_si128();
+    for (; k < (count & ~size_t(3)); k += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + k));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + k));
+        __m128i gt = _mm_cmpgt_epi32(b, a);
+        grew = _mm_or_si128(grew, gt);
+#if defined(__SSE4_1__)
+        _mm_storeu_si128((__m128i*)(dst + k), _mm_max_epi32(a, b));
+#else
+        _mm_storeu_si128((__m128i*)(dst + k), _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a)));
+#endif
+    }
+    changed = _mm_movemask_epi8(grew) != 0;
+#endif
+    // tail and scalar fallback
+    int grew_any = 0;
+    for (; k < count; ++k) {
+        int m = dst[k] > src[k] ? dst[k] : src[k];
+        grew_any |= (m != dst[k]);
+        dst[k] = m;
+    }
+    return changed || grew_any;
+}
+
+// single pass causal comparison of a against b, exits early once concurrent
+inline ClockOrder clock_compare(const int* a, const int* b, size_t count) {
+    size_t k = 0;
+    bool a_less = false, a_greater = false;
+#if defined(__AVX2__)
+    __m256i lt = _mm256_setzero_si256(), gt = _mm256_setzero_si256();
+    for (; k < (count & ~size_t(7)); k += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + k));
+        lt = _mm256_or_si256(lt, _mm256_cmpgt_epi32(y, x));
+        gt = _mm256_or_si256(gt, _mm256_cmpgt_epi32(x, y));
+        if ((k & 31) == 24 && !_mm256_testz_si256(lt, lt) && !_mm256_testz_si256(gt, gt)) {
+            return CLOCK_CONCURRENT;
+        }
+    }
+    a_less = !_mm256_testz_si256(lt, lt);
+    a_greater = !_mm256_testz_si256(gt, gt);
+#elif defined(__SSE2__)
+    __m128i lt = _mm_setzero_si128(), gt = _mm_setzero_si128();
+    for (; k < (count & ~size_t(3)); k += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + k));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + k));
+        lt = _mm_or_si128(lt, _mm_cmpgt_epi32(y, x));
+        gt = _mm_or_si128(gt, _mm_cmpgt_epi32(x, y));
+        if ((k & 31) == 28 && _mm_movemask_epi8(lt) && _mm_movemask_epi8(gt)) {
+            return CLOCK_CONCURRENT;
+        }
+    }
+    a_less = _mm_movemask_epi8(lt) != 0;
+    a_greater = _mm_movemask_epi8(gt) != 0;
+#endif
+    for (; k < count; ++k) {
+        a_less |= a[k] < b[k];
+        a_greater |= a[k] > b[k];
+    }
+    if (a_less && a_greater) return CLOCK_CONCURRENT;
+    if (a_less) return CLOCK_BEFORE;
+    if (a_greater) return CLOCK_AFTER;
+    return CLOCK_EQUAL;
+}
+
+inline bool clock_happened_before(const int* a, const int* b, size_t count) {
+    return clock_compare(a, b, count) == CLOCK_BEFORE;
+}
+
+inline bool clock_concurrent(const int* a, const int* b, size_t count) {
+    return clock_compare(a, b, count) == CLOCK_CONCURRENT;
+}
+
+// fixed-width vector clock for common cluster sizes
+template <size_t N>
+struct VectorClock {
+    std::array<int, N> v{};
+
+    void tick(int rank) { v[rank]++; }
+    bool merge(const VectorClock& other) { return clock_max_merge(v.data(), other.v.data(), N); }
+    ClockOrder compare(const VectorClock& other) const { return clock_compare(v.data(), other.v.data(), N); }
+    bool happened_before(const VectorClock& other) const { return compare(other) == CLOCK_BEFORE; }
+    bool concurrent(const VectorClock& other) const { return compare(other) == CLOCK_CONCURRENT; }
+};
+
+// kernels with the width baked in at compile time
+template <size_t N>
+bool clock_max_merge_fixed(int* dst, const int* src, size_t) { return clock_max_merge(dst, src, N); }
+
+template <size_t N>
+ClockOrder clock_compare_fixed(const int* a, const int* b, size_t) { return clock_compare(a, b, N); }
+
+// runtime dispatch: picks the specialized kernels when the width matches a
+// common cluster size, otherwise the generic ones
+struct ClockKernels {
+    size_t width = 0;
+    bool (*merge)(int*, const int*, size_t) = clock_max_merge;
+    ClockOrder (*compare)(const int*, const int*, size_t) = clock_compare;
+};
+
+inline ClockKernels select_clock_kernels(size_t width) {
+    ClockKernels k;
+    k.width = width;
+    switch (width) {
+        case 8:    k.merge = clock_max_merge_fixed<8>;    k.compare = clock_compare_fixed<8>;    break;
+        case 16:   k.merge = clock_max_merge_fixed<16>;   k.compare = clock_compare_fixed<16>;   break;
+        case 32:   k.merge = clock_max_merge_fixed<32>;   k.compare = clock_compare_fixed<32>;   break;
+        case 64:   k.merge = clock_max_merge_fixed<64>;   k.compare = clock_compare_fixed<64>;   break;
+        case 128:  k.merge = clock_max_merge_fixed<128>;  k.compare = clock_compare_fixed<128>;  break;
+        case 256:  k.merge = clock_max_merge_fixed<256>;  k.compare = clock_compare_fixed<256>;  break;
+        case 512:  k.merge = clock_max_merge_fixed<512>;  k.compare = clock_compare_fixed<512>;  break;
+        case 1024: k.merge = clock_max_merge_fixed<1024>; k.compare = clock_compare_fixed<1024>; break;
+        default: break;
+    }
+    return k;
+}
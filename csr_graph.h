@@ -0,0 +1,256 @@
+#pragma once
+
+// Distributed graph in compressed sparse row form, shared by the spanning
+// tree and BFS programs.
+// Vertices 0..n-1 are block-partitioned: rank r owns the contiguous range
+// [begin(r), begin(r) + count(r)). A rank stores the adjacency of its own
+// vertices only, as `offsets` (local vertex -> first edge) and `targets`
+// (global neighbour ids), so a graph of millions of vertices is spread over a
+// handful of ranks.
+//
+// Edge-list files are plain text, one "u v [weight]" per line, with '#' or
+// '%' comment lines. Every rank parses its own byte range of the file and the
+// edges are shuffled to their owners with one MPI_Alltoallv; edges are
+// treated as undirected, self loops and duplicates are dropped.
+
+#include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Partition {
+    int64_t n = 0;
+    int size = 1;
+    int64_t block = 1;
+
+    Partition() = default;
+    Partition(int64_t vertices, int ranks)
+        : n(vertices), size(ranks), block(std::max<int64_t>(1, (vertices + ranks - 1) / ranks)) {}
+
+    int owner(int64_t v) const { return (int)(v / block); }
+    int64_t begin(int rank) const { return std::min(n, (int64_t)rank * block); }
+    int64_t count(int rank) const { return std::min(n, begin(rank) + block) - begin(rank); }
+    int64_t local(int64_t v) const { return v - (int64_t)owner(v) * block; }
+};
+
+struct CsrGraph {
+    Partition part;
+    int rank = 0;
+    int64_t local_n = 0;
+    int64_t global_edges = 0;          // undirected edges after deduplication
+    std::vector<int64_t> offsets;      // local_n + 1
+    std::vector<int64_t> targets;      // global ids
+    std::vector<float> weights;        // parallel to targets, empty if unweighted
+
+    int64_t first() const { return part.begin(rank); }
+    int64_t global(int64_t local_v) const { return first() + local_v; }
+    bool owns(int64_t v) const { return part.owner(v) == rank; }
+    int64_t degree(int64_t local_v) const { return offsets[local_v + 1] - offsets[local_v]; }
+
+    size_t memory_bytes() const {
+        return offsets.capacity() * sizeof(int64_t) + targets.capacity() * sizeof(int64_t) +
+               weights.capacity() * sizeof(float);
+    }
+};
+
+// one directed half of an undirected edge, as shipped to the owner of `u`
+struct HalfEdge {
+    int64_t u, v;
+    float w;
+};
+
+// parse this rank's share of an edge-list file: the byte range is widened to
+// whole lines, a line belongs to the rank whose range contains its first byte.
+// A negative vertex id fails the read, since ids index the partition directly.
+inline bool read_edge_list_chunk(const std::string& path, int rank, int size, std::vector<HalfEdge>& edges, bool& weighted) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long long file_size = ftell(f);
+    long long lo = file_size * rank / size, hi = file_size * (rank + 1) / size;
+
+    // start after the line that straddles lo, stop after the line that straddles hi
+    long long start = lo;
+    if (lo > 0) {
+        fseek(f, lo - 1, SEEK_SET);
+        int c;
+        while ((c = fgetc(f)) != EOF && c != '\n') {}
+        start = ftell(f);
+    }
+    std::vector<char> buf;
+    if (start < hi) {
+        fseek(f, start, SEEK_SET);
+        buf.resize(hi - start);
+        buf.resize(fread(buf.data(), 1, buf.size(), f));
+        int c;
+        if (buf.empty() || buf.back() != '\n') {
+            while ((c = fgetc(f)) != EOF && c != '\n') buf.push_back((char)c);
+        }
+    }
+    fclose(f);
+    buf.push_back('\0');
+
+    weighted = false;
+    char* p = buf.data();
+    while (*p) {
+        char* line_end = p;
+        while (*line_end && *line_end != '\n') line_end++;
+        char saved = *line_end;
+        *line_end = '\0';
+        if (*p != '#' && *p != '%') {
+            char* q;
+            long long u = strtoll(p, &q, 10);
+            if (q != p) {
+                char* r;
+                long long v = strtoll(q, &r, 10);
+                if (r != q) {
+                    if (u < 0 || v < 0) {
+                        fprintf(stderr, "%s: negative vertex id in line \"%s\"\n", path.c_str(), p);
+                        return false;
+                    }
+                    char* s;
+                    float w = strtof(r, &s);
+                    if (s == r) w = 1.0f;
+                    else weighted = true;
+                    edges.push_back({u, v, w});
+                }
+            }
+        }
+        *line_end = saved;
+        p = saved ? line_end + 1 : line_end;
+    }
+    return true;
+}
+
+// build the CSR from edges held anywhere: both halves of every edge go to
+// their owners, then each rank sorts and deduplicates its adjacency
+inline CsrGraph build_csr_graph(MPI_Comm comm, const std::vector<HalfEdge>& edges, int64_t n, bool weighted) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    CsrGraph g;
+    g.rank = rank;
+    g.part = Partition(n, size);
+
+    std::vector<int> send_counts(size, 0), recv_counts(size), send_displs(size), recv_displs(size);
+    for (const HalfEdge& e : edges) {
+        if (e.u == e.v) continue;
+        send_counts[g.part.owner(e.u)]++;
+        send_counts[g.part.owner(e.v)]++;
+    }
+    for (int r = 0, sum = 0; r < size; ++r) { send_displs[r] = sum; sum += send_counts[r]; }
+    std::vector<HalfEdge> out(send_displs[size - 1] + send_counts[size - 1]);
+    std::vector<int> fill = send_displs;
+    for (const HalfEdge& e : edges) {
+        if (e.u == e.v) continue;
+        out[fill[g.part.owner(e.u)]++] = e;
+        out[fill[g.part.owner(e.v)]++] = {e.v, e.u, e.w};
+    }
+
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    for (int r = 0, sum = 0; r < size; ++r) { recv_displs[r] = sum; sum += recv_counts[r]; }
+    std::vector<HalfEdge> in(recv_displs[size - 1] + recv_counts[size - 1]);
+
+    MPI_Datatype half_edge_type;
+    MPI_Type_contiguous(sizeof(HalfEdge), MPI_BYTE, &half_edge_type);
+    MPI_Type_commit(&half_edge_type);
+    MPI_Alltoallv(out.data(), send_counts.data(), send_displs.data(), half_edge_type,
+                  in.data(), recv_counts.data(), recv_displs.data(), half_edge_type, comm);
+    MPI_Type_free(&half_edge_type);
+    std::vector<HalfEdge>().swap(out);
+
+    std::sort(in.begin(), in.end(), [](const HalfEdge& a, const HalfEdge& b) {
+        return a.u != b.u ? a.u < b.u : a.v != b.v ? a.v < b.v : a.w < b.w;
+    });
+    in.erase(std::unique(in.begin(), in.end(), [](const HalfEdge& a, const HalfEdge& b) {
+        return a.u == b.u && a.v == b.v;
+    }), in.end());
+
+    g.local_n = g.part.count(rank);
+    g.offsets.assign(g.local_n + 1, 0);
+    g.targets.resize(in.size());
+    if (weighted) g.weights.resize(in.size());
+    for (size_t k = 0; k < in.size(); ++k) {
+        g.offsets[g.part.local(in[k].u) + 1]++;
+        g.targets[k] = in[k].v;
+        if (weighted) g.weights[k] = in[k].w;
+    }
+    for (int64_t v = 0; v < g.local_n; ++v) g.offsets[v + 1] += g.offsets[v];
+
+    long long local_edges = in.size(), total = 0;
+    MPI_Allreduce(&local_edges, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    g.global_edges = total / 2;
+    return g;
+}
+
+// Graph500-style Kronecker (R-MAT) edges: 2^scale vertices and
+// edgefactor * 2^scale edges, split evenly across ranks. Initiator
+// probabilities are A = 0.57, B = C = 0.19. Vertex ids are scrambled with a
+// bijection on [0, 2^scale), so the high-degree vertices do not all land on
+// rank 0. Weights are uniform in [0, 1).
+inline std::vector<HalfEdge> generate_kronecker_edges(int scale, int edgefactor, int rank, int size, uint64_t seed) {
+    const int64_t n = (int64_t)1 << scale;
+    const int64_t total = n * edgefactor;
+    const int64_t lo = total * rank / size, hi = total * (rank + 1) / size;
+    const uint64_t mask = (uint64_t)n - 1;
+    const double a = 0.57, b = 0.19, c = 0.19;
+
+    auto scramble = [&](uint64_t v) {
+        v = (v * 0x9E3779B97F4A7C15ULL + seed) & mask;
+        v ^= v >> (scale / 2 + 1);
+        v = (v * 0xBF58476D1CE4E5B9ULL) & mask;
+        return (int64_t)v;
+    };
+
+    // reseeded per block of edges, so the graph does not depend on the rank count
+    const int64_t SEED_BLOCK = 4096;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<HalfEdge> edges;
+    edges.reserve(hi - lo);
+    for (int64_t e = lo; e < hi; ++e) {
+        if (e == lo || e % SEED_BLOCK == 0) {
+            rng.seed(seed ^ (0x94D049BB133111EBULL * (uint64_t)(e / SEED_BLOCK + 1)));
+            for (int64_t skip = e % SEED_BLOCK * (scale + 1); skip > 0; --skip) uniform(rng);
+        }
+        uint64_t u = 0, v = 0;
+        for (int bit = 0; bit < scale; ++bit) {
+            double r = uniform(rng);
+            int right = r >= a && (r < a + b || r >= a + b + c);   // quadrants B and D
+            int down = r >= a + b;                                 // quadrants C and D
+            u = (u << 1) | down;
+            v = (v << 1) | right;
+        }
+        edges.push_back({scramble(u), scramble(v), (float)uniform(rng)});
+    }
+    return edges;
+}
+
+// load an edge-list file collectively; n is one past the largest vertex id.
+// Fails on every rank if any rank cannot read its share.
+inline bool load_csr_graph(MPI_Comm comm, const std::string& path, CsrGraph& g) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    std::vector<HalfEdge> edges;
+    bool weighted = false;
+    int ok = read_edge_list_chunk(path, rank, size, edges, weighted), all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, comm);
+    if (!all_ok) return false;
+
+    long long max_id = -1, global_max = -1;
+    for (const HalfEdge& e : edges) max_id = std::max<long long>(max_id, std::max(e.u, e.v));
+    MPI_Allreduce(&max_id, &global_max, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    int any_weighted = weighted, global_weighted = 0;
+    MPI_Allreduce(&any_weighted, &global_weighted, 1, MPI_INT, MPI_MAX, comm);
+
+    g = build_csr_graph(comm, edges, global_max + 1, global_weighted);
+    return true;
+}
@@ -0,0 +1,580 @@
+#include <bits/stdc++.h>
+#include <mpi.h>
+#include "csr_graph.h"
+#include "rank_log.h"
+
+using namespace std;
+
+// Gallager-Humblet-Spira minimum spanning tree.
+// Every vertex of the partitioned CSR graph is a GHS node. Fragments grow by
+// merging along their minimum outgoing edge, and each fragment carries a level
+// and a name (its core edge). Records travel between vertices the same way as
+// in rst.cpp: batched per destination rank, with local records kept off MPI.
+// Ties between equal weights are broken by the endpoint ids, so every edge
+// weight is distinct, as GHS requires.
+
+// Record kinds, following rst.cpp's proposal / accept / reject tags
+#define M_C_TAG  0   // CONNECT(level): fragment asks to join along this edge
+#define M_P_TAG  1   // ACCEPT: the edge leads to another fragment
+#define M_R_TAG  2   // REJECT: the edge stays inside the fragment
+#define M_I_TAG  3   // INITIATE(level, name, state): new fragment identity, start a search
+#define M_T_TAG  4   // TEST(level, name): is this edge outgoing?
+#define M_RP_TAG 5   // REPORT(weight): best outgoing edge of a subtree
+#define M_CR_TAG 6   // CHANGEROOT: move the core towards the best edge
+
+#define M_BATCH_TAG 7   // MPI tag of a batch of records for one destination rank
+
+const int NUM_KINDS = 7;
+const char* KIND_NAMES[NUM_KINDS] = {"CONNECT", "ACCEPT", "REJECT", "INITIATE", "TEST", "REPORT", "CHANGEROOT"};
+
+const int64_t PRINT_LIMIT = 64;
+const int64_t LOG_LIMIT = 4096;
+const int64_t VERIFY_LIMIT = 4000000;     // edges gathered on rank 0 for the Kruskal check
+
+enum NodeState : uint8_t { SLEEPING, FIND, FOUND };
+enum EdgeState : uint8_t { BASIC, BRANCH, REJECTED };
+
+// total order on edges: weight, then the smaller endpoint, then the larger
+struct EdgeKey {
+    float w;
+    int64_t a, b;
+    bool operator<(const EdgeKey& o) const { return w != o.w ? w < o.w : a != o.a ? a < o.a : b < o.b; }
+    bool operator==(const EdgeKey& o) const { return w == o.w && a == o.a && b == o.b; }
+    bool operator!=(const EdgeKey& o) const { return !(*this == o); }
+};
+const EdgeKey INFINITE_KEY = {numeric_limits<float>::infinity(), -1, -1};
+
+// record layout: kind, from, to, level, weight bits, a, b, state
+const int RECORD = 8;
+using Record = array<int64_t, RECORD>;
+
+int64_t float_bits(float w) { uint32_t u; memcpy(&u, &w, 4); return u; }
+float bits_float(int64_t bits) { uint32_t u = (uint32_t)bits; float w; memcpy(&w, &u, 4); return w; }
+
+struct GhsResult {
+    long long messages = 0;
+    long long by_kind[NUM_KINDS] = {};
+    long long tree_edges = 0;
+    double weight = 0;
+    int max_level = 0;
+    long long fragments = 0;        // cores that halted, one per connected component
+    double seconds = 0;
+};
+
+// tree, if given, receives each local vertex's BRANCH edges (CSR indices)
+GhsResult run_ghs(const CsrGraph& g, MPI_Comm comm, bool verbose, vector<vector<int64_t>>* tree = nullptr) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    const int64_t local_n = g.local_n;
+    const int64_t local_m = g.targets.size();
+
+    auto key = [&](int64_t lv, int64_t k) {
+        int64_t v = g.global(lv), u = g.targets[k];
+        return EdgeKey{g.weights.empty() ? 1.0f : g.weights[k], min(v, u), max(v, u)};
+    };
+
+    // per-vertex state
+    vector<uint8_t> SN(local_n, SLEEPING);
+    vector<int32_t> LN(local_n, 0);
+    vector<EdgeKey> FN(local_n, INFINITE_KEY), best_wt(local_n, INFINITE_KEY);
+    vector<int64_t> in_branch(local_n, -1), best_edge(local_n, -1), test_edge(local_n, -1);
+    vector<int32_t> find_count(local_n, 0);
+    // per-edge state, and each vertex's edges in increasing weight for finding the lightest BASIC one
+    vector<uint8_t> SE(local_m, BASIC);
+    vector<int64_t> by_weight(local_m), next_basic(local_n);
+    for (int64_t lv = 0; lv < local_n; ++lv) {
+        iota(by_weight.begin() + g.offsets[lv], by_weight.begin() + g.offsets[lv + 1], g.offsets[lv]);
+        sort(by_weight.begin() + g.offsets[lv], by_weight.begin() + g.offsets[lv + 1],
+             [&](int64_t x, int64_t y) { return key(lv, x) < key(lv, y); });
+        next_basic[lv] = g.offsets[lv];
+    }
+    auto edge_to = [&](int64_t lv, int64_t u) {
+        return lower_bound(g.targets.begin() + g.offsets[lv], g.targets.begin() + g.offsets[lv + 1], u) - g.targets.begin();
+    };
+
+    GhsResult result;
+    vector<vector<int64_t>> outbox(size);
+    deque<Record> local_queue;
+    unordered_map<int64_t, deque<Record>> deferred;
+    struct PendingSend { MPI_Request request; vector<int64_t> data; };
+    deque<PendingSend> in_flight;
+    long long batches_sent = 0, batches_received = 0;
+
+    auto send = [&](int kind, int64_t lv, int64_t k, int64_t level = 0, EdgeKey w = INFINITE_KEY, int64_t state = 0) {
+        Record r = {kind, g.global(lv), g.targets[k], level, float_bits(w.w), w.a, w.b, state};
+        int owner = g.part.owner(r[2]);
+        if (owner == rank) local_queue.push_back(r);
+        else outbox[owner].insert(outbox[owner].end(), r.begin(), r.end());
+        result.messages++;
+        result.by_kind[kind]++;
+    };
+
+    auto wakeup = [&](int64_t lv) {
+        int64_t m = by_weight[g.offsets[lv]];
+        SE[m] = BRANCH;
+        LN[lv] = 0;
+        SN[lv] = FOUND;
+        find_count[lv] = 0;
+        send(M_C_TAG, lv, m, 0);
+    };
+
+    auto report = [&](int64_t lv) {
+        if (find_count[lv] == 0 && test_edge[lv] < 0) {
+            SN[lv] = FOUND;
+            send(M_RP_TAG, lv, in_branch[lv], 0, best_wt[lv]);
+        }
+    };
+
+    auto test = [&](int64_t lv) {
+        int64_t& p = next_basic[lv];
+        while (p < g.offsets[lv + 1] && SE[by_weight[p]] != BASIC) p++;
+        if (p < g.offsets[lv + 1]) {
+            test_edge[lv] = by_weight[p];
+            send(M_T_TAG, lv, test_edge[lv], LN[lv], FN[lv]);
+        }
+        else {
+            test_edge[lv] = -1;
+            report(lv);
+        }
+    };
+
+    auto change_root = [&](int64_t lv) {
+        int64_t b = best_edge[lv];
+        if (SE[b] == BRANCH) send(M_CR_TAG, lv, b);
+        else {
+            send(M_C_TAG, lv, b, LN[lv]);
+            SE[b] = BRANCH;
+        }
+    };
+
+    // returns false when the record has to wait for this vertex's state to change
+    auto process = [&](const Record& r) -> bool {
+        int64_t lv = g.part.local(r[2]);
+        int64_t j = edge_to(lv, r[1]);
+        int32_t level = (int32_t)r[3];
+        EdgeKey w = {bits_float(r[4]), r[5], r[6]};
+
+        switch (r[0]) {
+            case M_C_TAG: {
+                if (SN[lv] == SLEEPING) wakeup(lv);
+                if (level < LN[lv]) {
+                    // absorb the lower-level fragment
+                    SE[j] = BRANCH;
+                    send(M_I_TAG, lv, j, LN[lv], FN[lv], SN[lv]);
+                    if (SN[lv] == FIND) find_count[lv]++;
+                }
+                else if (SE[j] == BASIC) return false;
+                else {
+                    // both sides asked on the same edge: merge into a fragment one level up
+                    send(M_I_TAG, lv, j, LN[lv] + 1, key(lv, j), FIND);
+                }
+                return true;
+            }
+            case M_I_TAG: {
+                if (verbose && level > LN[lv]) RLOG(LOG_INFO, EV_RECV, "V{a}: joined fragment at level {b}.", g.part.owner(r[1]), M_I_TAG, 0, r[2], level);
+                LN[lv] = level;
+                FN[lv] = w;
+                SN[lv] = (uint8_t)r[7];
+                in_branch[lv] = j;
+                best_edge[lv] = -1;
+                best_wt[lv] = INFINITE_KEY;
+                for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+                    if (k == j || SE[k] != BRANCH) continue;
+                    send(M_I_TAG, lv, k, level, w, r[7]);
+                    if (r[7] == FIND) find_count[lv]++;
+                }
+                if (r[7] == FIND) test(lv);
+                return true;
+            }
+            case M_T_TAG: {
+                if (SN[lv] == SLEEPING) wakeup(lv);
+                if (level > LN[lv]) return false;
+                if (w != FN[lv]) send(M_P_TAG, lv, j);
+                else {
+                    if (SE[j] == BASIC) SE[j] = REJECTED;
+                    if (test_edge[lv] != j) send(M_R_TAG, lv, j);
+                    else test(lv);
+                }
+                return true;
+            }
+            case M_P_TAG: {
+                test_edge[lv] = -1;
+                if (key(lv, j) < best_wt[lv]) {
+                    best_edge[lv] = j;
+                    best_wt[lv] = key(lv, j);
+                }
+                report(lv);
+                return true;
+            }
+            case M_R_TAG: {
+                if (SE[j] == BASIC) SE[j] = REJECTED;
+                test(lv);
+                return true;
+            }
+            case M_RP_TAG: {
+                if (j != in_branch[lv]) {
+                    find_count[lv]--;
+                    if (w < best_wt[lv]) {
+                        best_wt[lv] = w;
+                        best_edge[lv] = j;
+                    }
+                    report(lv);
+                }
+                else if (SN[lv] == FIND) return false;
+                else if (best_wt[lv] < w) change_root(lv);
+                else if (w == INFINITE_KEY && best_wt[lv] == INFINITE_KEY) {
+                    // both core nodes found no outgoing edge: this component is done
+                    if (g.global(lv) < r[1]) {
+                        result.fragments++;
+                        if (verbose) RLOG(LOG_INFO, EV_STATE, "V{a}: core of the final fragment, level {b}. HALT.", -1, M_RP_TAG, 0, r[2], LN[lv]);
+                    }
+                }
+                return true;
+            }
+            case M_CR_TAG: {
+                change_root(lv);
+                return true;
+            }
+        }
+        return true;
+    };
+
+    // GHS lets a node postpone a message until its level or state has caught
+    // up; postponed records are retried whenever that node processes another.
+    auto deliver = [&](const Record& r) {
+        int64_t lv = g.part.local(r[2]);
+        if (!process(r)) {
+            deferred[lv].push_back(r);
+            return;
+        }
+        auto it = deferred.find(lv);
+        if (it == deferred.end()) return;
+        deque<Record>& q = it->second;
+        for (bool progress = true; progress && !q.empty();) {
+            progress = false;
+            for (size_t i = 0, n = q.size(); i < n; ++i) {
+                Record d = q.front();
+                q.pop_front();
+                if (process(d)) progress = true;
+                else q.push_back(d);
+            }
+        }
+        if (q.empty()) deferred.erase(it);
+    };
+
+    auto flush = [&]() {
+        for (int r = 0; r < size; ++r) {
+            if (outbox[r].empty()) continue;
+            in_flight.push_back({MPI_REQUEST_NULL, move(outbox[r])});
+            outbox[r].clear();
+            PendingSend& s = in_flight.back();
+            MPI_Isend(s.data.data(), (int)s.data.size(), MPI_INT64_T, r, M_BATCH_TAG, comm, &s.request);
+            batches_sent++;
+        }
+        while (!in_flight.empty()) {
+            int done = 0;
+            MPI_Test(&in_flight.front().request, &done, MPI_STATUS_IGNORE);
+            if (!done) break;
+            in_flight.pop_front();
+        }
+    };
+
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+
+    // every node wakes up spontaneously; isolated vertices have nothing to do
+    for (int64_t lv = 0; lv < local_n; ++lv)
+        if (g.degree(lv) > 0 && SN[lv] == SLEEPING) wakeup(lv);
+
+    // same termination detection as rst.cpp: two identical waves of (sent, received) batch totals
+    long long counts[2], totals[2], previous[2] = {-1, -1};
+    MPI_Request wave = MPI_REQUEST_NULL;
+    bool wave_open = false, finished = false;
+    vector<int64_t> batch;
+
+    while (!finished) {
+        bool busy = false;
+
+        MPI_Message msg;
+        MPI_Status status;
+        int has_msg = 0;
+        MPI_Improbe(MPI_ANY_SOURCE, M_BATCH_TAG, comm, &has_msg, &msg, &status);
+        while (has_msg) {
+            int count;
+            MPI_Get_count(&status, MPI_INT64_T, &count);
+            batch.resize(count);
+            MPI_Mrecv(batch.data(), count, MPI_INT64_T, &msg, MPI_STATUS_IGNORE);
+            batches_received++;
+            for (int k = 0; k + RECORD <= count; k += RECORD) {
+                Record r;
+                copy(batch.begin() + k, batch.begin() + k + RECORD, r.begin());
+                deliver(r);
+            }
+            busy = true;
+            MPI_Improbe(MPI_ANY_SOURCE, M_BATCH_TAG, comm, &has_msg, &msg, &status);
+        }
+
+        while (!local_queue.empty()) {
+            Record r = local_queue.front();
+            local_queue.pop_front();
+            deliver(r);
+            busy = true;
+        }
+
+        flush();
+        if (busy) continue;
+
+        if (!wave_open) {
+            counts[0] = batches_sent;
+            counts[1] = batches_received;
+            MPI_Iallreduce(counts, totals, 2, MPI_LONG_LONG, MPI_SUM, comm, &wave);
+            wave_open = true;
+        }
+        int done = 0;
+        MPI_Test(&wave, &done, MPI_STATUS_IGNORE);
+        if (done) {
+            wave_open = false;
+            finished = totals[0] == totals[1] && totals[0] == previous[0] && totals[1] == previous[1];
+            previous[0] = totals[0];
+            previous[1] = totals[1];
+        }
+    }
+    while (!in_flight.empty()) {
+        MPI_Wait(&in_flight.front().request, MPI_STATUS_IGNORE);
+        in_flight.pop_front();
+    }
+    result.seconds = MPI_Wtime() - t0;
+
+    // the MST is the set of BRANCH edges, counted from their smaller endpoint
+    long long stuck = 0;
+    for (const auto& d : deferred) stuck += d.second.size();
+    if (tree) tree->assign(local_n, {});
+    for (int64_t lv = 0; lv < local_n; ++lv) {
+        result.max_level = max(result.max_level, LN[lv]);
+        for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+            if (SE[k] != BRANCH) continue;
+            if (tree) (*tree)[lv].push_back(k);
+            if (g.targets[k] < g.global(lv)) continue;
+            result.tree_edges++;
+            result.weight += g.weights.empty() ? 1.0 : g.weights[k];
+        }
+    }
+    if (stuck > 0) cerr << "[Rank " << rank << "] " << stuck << " GHS records never became deliverable\n";
+
+    long long local_counts[3 + NUM_KINDS] = {result.messages, result.tree_edges, result.fragments};
+    copy(result.by_kind, result.by_kind + NUM_KINDS, local_counts + 3);
+    long long global_counts[3 + NUM_KINDS];
+    MPI_Allreduce(local_counts, global_counts, 3 + NUM_KINDS, MPI_LONG_LONG, MPI_SUM, comm);
+    result.messages = global_counts[0];
+    result.tree_edges = global_counts[1];
+    result.fragments = global_counts[2];
+    copy(global_counts + 3, global_counts + 3 + NUM_KINDS, result.by_kind);
+    double weight = result.weight;
+    MPI_Allreduce(&weight, &result.weight, 1, MPI_DOUBLE, MPI_SUM, comm);
+    int level = result.max_level;
+    MPI_Allreduce(&level, &result.max_level, 1, MPI_INT, MPI_MAX, comm);
+    double seconds = result.seconds;
+    MPI_Allreduce(&seconds, &result.seconds, 1, MPI_DOUBLE, MPI_MAX, comm);
+    return result;
+}
+
+// Sequential Kruskal over the whole edge set on rank 0, with the same tie
+// breaking as EdgeKey. Returns the forest's weight and edge count, or -1
+// edges when the graph is too large to gather.
+pair<double, long long> kruskal_check(const CsrGraph& g, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    if (g.global_edges > VERIFY_LIMIT) return {0, -1};
+
+    vector<HalfEdge> mine;
+    for (int64_t lv = 0; lv < g.local_n; ++lv)
+        for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k)
+            if (g.global(lv) < g.targets[k]) mine.push_back({g.global(lv), g.targets[k], g.weights.empty() ? 1.0f : g.weights[k]});
+
+    MPI_Datatype half_edge_type;
+    MPI_Type_contiguous(sizeof(HalfEdge), MPI_BYTE, &half_edge_type);
+    MPI_Type_commit(&half_edge_type);
+    int count = mine.size();
+    vector<int> counts(size), displs(size);
+    MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+    int total = 0;
+    for (int r = 0; r < size; ++r) { displs[r] = total; total += counts[r]; }
+    vector<HalfEdge> all(rank == 0 ? total : 0);
+    MPI_Gatherv(mine.data(), count, half_edge_type, all.data(), counts.data(), displs.data(), half_edge_type, 0, comm);
+    MPI_Type_free(&half_edge_type);
+    if (rank != 0) return {0, 0};
+
+    sort(all.begin(), all.end(), [](const HalfEdge& x, const HalfEdge& y) {
+        return EdgeKey{x.w, x.u, x.v} < EdgeKey{y.w, y.u, y.v};
+    });
+    vector<int64_t> up(g.part.n);
+    iota(up.begin(), up.end(), 0);
+    function<int64_t(int64_t)> find = [&](int64_t x) {
+        while (up[x] != x) x = up[x] = up[up[x]];
+        return x;
+    };
+    double weight = 0;
+    long long edges = 0;
+    for (const HalfEdge& e : all) {
+        int64_t a = find(e.u), b = find(e.v);
+        if (a == b) continue;
+        up[a] = b;
+        weight += e.w;
+        edges++;
+    }
+    return {weight, edges};
+}
+
+// O(E + N log N) message bound from the GHS paper: 5 N log2 N + 2 E
+double ghs_bound(int64_t n, int64_t e) { return 5.0 * n * log2((double)max<int64_t>(2, n)) + 2.0 * e; }
+
+// the 6-vertex rst.cpp example with weights, used when no edge-list file is given
+vector<HalfEdge> builtin_edges() {
+    return {{0, 1, 4}, {0, 3, 1}, {1, 2, 3}, {1, 3, 2}, {1, 4, 5}, {3, 4, 7}, {4, 5, 6}};
+}
+
+uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+float unit_weight(uint64_t h) { return (float)((h >> 11) * (1.0 / 9007199254740992.0)); }
+
+// connected random graph: a random tree (v joins a random earlier vertex)
+// plus `extra` random edges per vertex; every rank generates its own vertices' edges
+vector<HalfEdge> random_graph_edges(const Partition& part, int rank, int extra) {
+    vector<HalfEdge> edges;
+    for (int64_t v = part.begin(rank); v < part.begin(rank) + part.count(rank); ++v) {
+        uint64_t h = mix64(v);
+        if (v > 0) edges.push_back({v, (int64_t)(h % v), unit_weight(mix64(h))});
+        for (int k = 0; k < extra; ++k) {
+            h = mix64(h + k);
+            edges.push_back({v, (int64_t)(h % part.n), unit_weight(mix64(h ^ 0x5555))});
+        }
+    }
+    return edges;
+}
+
+// side x side grid, each vertex linked to its right and lower neighbour
+vector<HalfEdge> grid_graph_edges(const Partition& part, int rank, int64_t side) {
+    vector<HalfEdge> edges;
+    for (int64_t v = part.begin(rank); v < part.begin(rank) + part.count(rank); ++v) {
+        int64_t row = v / side, col = v % side;
+        if (col + 1 < side) edges.push_back({v, v + 1, unit_weight(mix64(2 * v))});
+        if (row + 1 < side) edges.push_back({v, v + side, unit_weight(mix64(2 * v + 1))});
+    }
+    return edges;
+}
+
+void print_result(const GhsResult& r, const CsrGraph& g, pair<double, long long> check) {
+    cout << fixed << setprecision(3);
+    cout << "MST: " << r.tree_edges << " edges, weight " << r.weight << ", " << r.fragments << " component(s), max fragment level "
+         << r.max_level << "\n";
+    if (check.second >= 0) {
+        bool ok = check.second == r.tree_edges && fabs(check.first - r.weight) <= 1e-6 * max(1.0, fabs(check.first));
+        cout << "Kruskal check: " << check.second << " edges, weight " << check.first << (ok ? " (match)" : " (MISMATCH)") << "\n";
+    }
+    cout << "Messages: " << r.messages;
+    for (int k = 0; k < NUM_KINDS; ++k) cout << (k ? ", " : " (") << KIND_NAMES[k] << " " << r.by_kind[k];
+    cout << ")\n";
+    cout << setprecision(2) << "Bound 5N log2 N + 2E = " << ghs_bound(g.part.n, g.global_edges) << ", used "
+         << 100.0 * r.messages / ghs_bound(g.part.n, g.global_edges) << "%\n";
+    cout << setprecision(4) << "Time: " << r.seconds << " s\n";
+}
+
+void run_benchmark(int rank, int size, int max_log) {
+    if (rank == 0) {
+        cout << fixed << "GHS messages and time against the 5N log2 N + 2E bound (" << size << " ranks)\n";
+        cout << setw(8) << "graph" << setw(10) << "N" << setw(10) << "E" << setw(12) << "messages" << setw(12) << "bound"
+             << setw(8) << "ratio" << setw(7) << "level" << setw(10) << "time(s)" << setw(8) << "check" << "\n";
+    }
+    for (int lg = 10; lg <= max_log; lg += 2) {
+        for (int kind = 0; kind < 2; ++kind) {
+            int64_t side = (int64_t)1 << (lg / 2);
+            Partition part(kind == 0 ? (int64_t)1 << lg : side * side, size);
+            vector<HalfEdge> edges = kind == 0 ? random_graph_edges(part, rank, 3) : grid_graph_edges(part, rank, side);
+            CsrGraph g = build_csr_graph(MPI_COMM_WORLD, edges, part.n, true);
+            vector<HalfEdge>().swap(edges);
+
+            GhsResult r = run_ghs(g, MPI_COMM_WORLD, false);
+            pair<double, long long> check = kruskal_check(g, MPI_COMM_WORLD);
+            if (rank == 0) {
+                bool ok = check.second == r.tree_edges && fabs(check.first - r.weight) <= 1e-6 * max(1.0, fabs(check.first));
+                double bound = ghs_bound(g.part.n, g.global_edges);
+                cout << setw(8) << (kind == 0 ? "random" : "grid") << setw(10) << g.part.n << setw(10) << g.global_edges
+                     << setw(12) << r.messages << setw(12) << (long long)bound << setw(8) << setprecision(3) << r.messages / bound
+                     << setw(7) << r.max_level << setw(10) << setprecision(4) << r.seconds
+                     << setw(8) << (check.second < 0 ? "-" : ok ? "ok" : "FAIL") << "\n";
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    string arg = argc > 1 ? argv[1] : "";
+    if (arg == "bench") {
+        run_benchmark(rank, size, argc > 2 ? atoi(argv[2]) : 16);
+        MPI_Finalize();
+        return 0;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+    CsrGraph g;
+    if (arg.empty()) {
+        vector<HalfEdge> edges = rank == 0 ? builtin_edges() : vector<HalfEdge>();
+        g = build_csr_graph(MPI_COMM_WORLD, edges, 6, true);
+    }
+    else if (!load_csr_graph(MPI_COMM_WORLD, arg, g)) {
+        if (rank == 0) cerr << "Error: cannot read edge list " << arg << "\n";
+        MPI_Finalize();
+        return 1;
+    }
+    double build_time = MPI_Wtime() - t0;
+
+    unique_ptr<RankLog> event_log;
+    if (g.part.n <= LOG_LIMIT) {
+        event_log.reset(new RankLog("ghs", rank));
+        if (rank == 0) cout << "Per-event log: ghs.rank<N>.log\n";
+    }
+
+    vector<vector<int64_t>> tree;
+    GhsResult r = run_ghs(g, MPI_COMM_WORLD, (bool)event_log, &tree);
+    pair<double, long long> check = kruskal_check(g, MPI_COMM_WORLD);
+
+    if (g.part.n <= PRINT_LIMIT) {
+        // every rank prints its vertices' tree edges, in rank order
+        for (int i = 0; i < size; ++i) {
+            if (rank == i) {
+                for (int64_t lv = 0; lv < g.local_n; ++lv) {
+                    cout << "   [V" << g.global(lv) << " @ Rank " << rank << "] MST edges: ";
+                    if (tree[lv].empty()) cout << "None.";
+                    for (int64_t k : tree[lv]) cout << "V" << g.targets[k] << " (" << (g.weights.empty() ? 1.0f : g.weights[k]) << ") ";
+                    cout << "\n";
+                }
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+    }
+
+    if (rank == 0) {
+        cout << "Graph: " << g.part.n << " vertices, " << g.global_edges << " edges on " << size << " ranks, loaded in "
+             << fixed << setprecision(3) << build_time << " s\n";
+        print_result(r, g, check);
+    }
+
+    event_log.reset();
+    MPI_Finalize();
+    return 0;
+}
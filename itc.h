@@ -0,0 +1,303 @@
+#pragma once
+
+// Interval Tree Clocks (Almeida, Baquero, Fonte 2008).
+// A stamp is an (id, event) pair of trees: the id tree records which part of
+// the [0, 1) interval a worker owns, the event tree how far each part has
+// advanced. fork() splits the id so workers can be created without global
+// coordination, join() merges both trees so retired ids are reclaimed, and
+// event() inflates the event tree only over the owned interval. The size of
+// a stamp follows the number of live workers, not the number ever created.
+//
+// Trees are immutable and shared between stamps through shared_ptr.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ItcIdNode;
+struct ItcEventNode;
+using ItcId = std::shared_ptr<const ItcIdNode>;
+using ItcEvent = std::shared_ptr<const ItcEventNode>;
+
+// id: leaf 0 / leaf 1, or an internal node (l, r)
+struct ItcIdNode {
+    bool leaf;
+    int value;
+    ItcId l, r;
+};
+
+// event: leaf n, or an internal node (n, l, r) whose children are relative to n
+struct ItcEventNode {
+    int n;
+    ItcEvent l, r;
+    bool leaf() const { return !l; }
+};
+
+namespace itc {
+
+inline ItcId id_leaf(int v) {
+    static const ItcId zero = std::make_shared<const ItcIdNode>(ItcIdNode{true, 0, nullptr, nullptr});
+    static const ItcId one = std::make_shared<const ItcIdNode>(ItcIdNode{true, 1, nullptr, nullptr});
+    return v ? one : zero;
+}
+inline bool is_id(const ItcId& i, int v) { return i->leaf && i->value == v; }
+
+inline ItcId id_node(ItcId l, ItcId r) {
+    if (is_id(l, 0) && is_id(r, 0)) return id_leaf(0);
+    if (is_id(l, 1) && is_id(r, 1)) return id_leaf(1);
+    return std::make_shared<const ItcIdNode>(ItcIdNode{false, 0, std::move(l), std::move(r)});
+}
+
+inline std::pair<ItcId, ItcId> split(const ItcId& i) {
+    if (is_id(i, 0)) return {id_leaf(0), id_leaf(0)};
+    if (is_id(i, 1)) {
+        return {id_node(id_leaf(1), id_leaf(0)), id_node(id_leaf(0), id_leaf(1))};
+    }
+    if (is_id(i->l, 0)) {
+        auto s = split(i->r);
+        return {id_node(id_leaf(0), s.first), id_node(id_leaf(0), s.second)};
+    }
+    if (is_id(i->r, 0)) {
+        auto s = split(i->l);
+        return {id_node(s.first, id_leaf(0)), id_node(s.second, id_leaf(0))};
+    }
+    return {id_node(i->l, id_leaf(0)), id_node(id_leaf(0), i->r)};
+}
+
+inline ItcId sum(const ItcId& a, const ItcId& b) {
+    if (is_id(a, 0)) return b;
+    if (is_id(b, 0)) return a;
+    if (a->leaf || b->leaf) return id_leaf(1);   // overlapping ids; cannot happen for disjoint forks
+    return id_node(sum(a->l, b->l), sum(a->r, b->r));
+}
+
+inline ItcEvent ev_leaf(int n) {
+    static const ItcEvent zero = std::make_shared<const ItcEventNode>(ItcEventNode{0, nullptr, nullptr});
+    if (n == 0) return zero;
+    return std::make_shared<const ItcEventNode>(ItcEventNode{n, nullptr, nullptr});
+}
+inline ItcEvent lift(const ItcEvent& e, int m) {
+    if (m == 0) return e;
+    return std::make_shared<const ItcEventNode>(ItcEventNode{e->n + m, e->l, e->r});
+}
+// trees are kept normalised (one child of every node has minimum 0), so the
+// minimum is the base value and only the maximum needs a walk
+inline int ev_min(const ItcEvent& e) { return e->n; }
+inline int ev_max(const ItcEvent& e) { return e->leaf() ? e->n : e->n + std::max(ev_max(e->l), ev_max(e->r)); }
+
+// (n, l, r) as given, used to expand a leaf before descending into it
+inline ItcEvent ev_raw(int n, const ItcEvent& l, const ItcEvent& r) {
+    return std::make_shared<const ItcEventNode>(ItcEventNode{n, l, r});
+}
+
+// normalising constructor for (n, l, r)
+inline ItcEvent ev_node(int n, const ItcEvent& l, const ItcEvent& r) {
+    if (l->leaf() && r->leaf() && l->n == r->n) return ev_leaf(n + l->n);
+    int m = std::min(ev_min(l), ev_min(r));
+    return std::make_shared<const ItcEventNode>(ItcEventNode{n + m, lift(l, -m), lift(r, -m)});
+}
+
+// leq and join carry the lifted base of each side down the recursion
+// instead of allocating lifted copies of every subtree
+inline bool leq_at(const ItcEvent& a, int da, const ItcEvent& b, int db) {
+    int ba = a->n + da, bb = b->n + db;
+    if (a->leaf()) return ba <= bb;
+    if (ba > bb) return false;
+    if (b->leaf()) return leq_at(a->l, ba, b, db) && leq_at(a->r, ba, b, db);
+    return leq_at(a->l, ba, b->l, bb) && leq_at(a->r, ba, b->r, bb);
+}
+inline bool leq(const ItcEvent& a, const ItcEvent& b) { return leq_at(a, 0, b, 0); }
+
+inline ItcEvent join_at(const ItcEvent& a, int da, const ItcEvent& b, int db) {
+    int ba = a->n + da, bb = b->n + db;
+    // a normalised tree never drops below its base, so a leaf at or under
+    // the other side's base is dominated
+    if (b->leaf() && bb <= ba) return lift(a, da);
+    if (a->leaf() && ba <= bb) return lift(b, db);
+    if (ba > bb) return join_at(b, db, a, da);
+    // ba < bb, a is a node; a leaf b counts as (bb, 0, 0)
+    ItcEvent zero = ev_leaf(0);
+    return ev_node(ba, join_at(a->l, 0, b->leaf() ? zero : b->l, bb - ba),
+                       join_at(a->r, 0, b->leaf() ? zero : b->r, bb - ba));
+}
+inline ItcEvent join(const ItcEvent& a, const ItcEvent& b) { return join_at(a, 0, b, 0); }
+
+// simplify the event tree over the owned interval without inflating it
+inline ItcEvent fill(const ItcId& i, const ItcEvent& e) {
+    if (is_id(i, 0) || e->leaf()) return e;
+    if (is_id(i, 1)) return ev_leaf(ev_max(e));
+    if (is_id(i->l, 1)) {
+        ItcEvent er = fill(i->r, e->r);
+        return ev_node(e->n, ev_leaf(std::max(ev_max(e->l), ev_min(er))), er);
+    }
+    if (is_id(i->r, 1)) {
+        ItcEvent el = fill(i->l, e->l);
+        return ev_node(e->n, el, ev_leaf(std::max(ev_max(e->r), ev_min(el))));
+    }
+    ItcEvent el = fill(i->l, e->l), er = fill(i->r, e->r);
+    if (el == e->l && er == e->r) return e;
+    return ev_node(e->n, el, er);
+}
+
+// inflate the event tree over the owned interval at the smallest cost
+inline std::pair<ItcEvent, int> grow(const ItcId& i, const ItcEvent& e) {
+    const int EXPAND_COST = 1 << 20;
+    if (e->leaf()) {
+        if (is_id(i, 1)) return {ev_leaf(e->n + 1), 0};
+        // expand the leaf into (n, 0, 0), penalised so existing nodes are preferred
+        auto g = grow(i, ev_raw(e->n, ev_leaf(0), ev_leaf(0)));
+        return {g.first, g.second + EXPAND_COST};
+    }
+    if (is_id(i->l, 0)) {
+        auto g = grow(i->r, e->r);
+        return {ev_node(e->n, e->l, g.first), g.second + 1};
+    }
+    if (is_id(i->r, 0)) {
+        auto g = grow(i->l, e->l);
+        return {ev_node(e->n, g.first, e->r), g.second + 1};
+    }
+    auto gl = grow(i->l, e->l);
+    auto gr = grow(i->r, e->r);
+    if (gl.second < gr.second) return {ev_node(e->n, gl.first, e->r), gl.second + 1};
+    return {ev_node(e->n, e->l, gr.first), gr.second + 1};
+}
+
+// bit-level encoding: ids use 2-bit tags, events a leaf bit plus flags for
+// zero base / zero children, numbers in Elias-gamma
+class BitWriter {
+public:
+    std::vector<uint8_t> bytes;
+    void put(unsigned bit) {
+        if (bits_ % 8 == 0) bytes.push_back(0);
+        if (bit) bytes.back() |= 1u << (bits_ % 8);
+        bits_++;
+    }
+    void put_num(uint32_t n) {   // Elias gamma of n + 1
+        uint64_t v = (uint64_t)n + 1;
+        int len = 63 - __builtin_clzll(v);
+        for (int k = 0; k < len; ++k) put(0);
+        for (int k = len; k >= 0; --k) put((v >> k) & 1);
+    }
+private:
+    size_t bits_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    unsigned get() {
+        if (bits_ / 8 >= size_) return 0;
+        unsigned b = (data_[bits_ / 8] >> (bits_ % 8)) & 1;
+        bits_++;
+        return b;
+    }
+    uint32_t get_num() {
+        int len = 0;
+        while (get() == 0 && len < 32) len++;
+        uint64_t v = 1;
+        for (int k = 0; k < len; ++k) v = (v << 1) | get();
+        return (uint32_t)(v - 1);
+    }
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t bits_ = 0;
+};
+
+inline void encode_id(const ItcId& i, BitWriter& w) {
+    if (i->leaf) { w.put(0); w.put(0); w.put(i->value); return; }
+    if (is_id(i->l, 0)) { w.put(0); w.put(1); encode_id(i->r, w); return; }
+    if (is_id(i->r, 0)) { w.put(1); w.put(0); encode_id(i->l, w); return; }
+    w.put(1); w.put(1); encode_id(i->l, w); encode_id(i->r, w);
+}
+
+inline ItcId decode_id(BitReader& r) {
+    unsigned a = r.get(), b = r.get();
+    if (!a && !b) return id_leaf(r.get());
+    if (!a) return id_node(id_leaf(0), decode_id(r));
+    if (!b) return id_node(decode_id(r), id_leaf(0));
+    ItcId l = decode_id(r);
+    return id_node(l, decode_id(r));
+}
+
+inline bool is_zero_leaf(const ItcEvent& e) { return e->leaf() && e->n == 0; }
+
+inline void encode_event(const ItcEvent& e, BitWriter& w) {
+    if (e->leaf()) { w.put(1); w.put_num(e->n); return; }
+    w.put(0);
+    w.put(e->n != 0);
+    w.put(!is_zero_leaf(e->l));
+    w.put(!is_zero_leaf(e->r));
+    if (e->n != 0) w.put_num(e->n);
+    if (!is_zero_leaf(e->l)) encode_event(e->l, w);
+    if (!is_zero_leaf(e->r)) encode_event(e->r, w);
+}
+
+inline ItcEvent decode_event(BitReader& r) {
+    if (r.get()) return ev_leaf(r.get_num());
+    bool has_n = r.get(), has_l = r.get(), has_r = r.get();
+    int n = has_n ? r.get_num() : 0;
+    ItcEvent l = has_l ? decode_event(r) : ev_leaf(0);
+    ItcEvent rr = has_r ? decode_event(r) : ev_leaf(0);
+    return ev_raw(n, l, rr);
+}
+
+inline std::string id_to_string(const ItcId& i) {
+    if (i->leaf) return std::to_string(i->value);
+    return "(" + id_to_string(i->l) + "," + id_to_string(i->r) + ")";
+}
+
+inline std::string event_to_string(const ItcEvent& e) {
+    if (e->leaf()) return std::to_string(e->n);
+    return "(" + std::to_string(e->n) + "," + event_to_string(e->l) + "," + event_to_string(e->r) + ")";
+}
+
+}  // namespace itc
+
+// one worker's clock
+struct ItcStamp {
+    ItcId id = itc::id_leaf(1);
+    ItcEvent event = itc::ev_leaf(0);
+
+    static ItcStamp seed() { return ItcStamp(); }
+
+    // split this worker's id; returns the new worker, this keeps the other half
+    ItcStamp fork() {
+        auto halves = itc::split(id);
+        id = halves.first;
+        return ItcStamp{halves.second, event};
+    }
+
+    void tick() {
+        ItcEvent filled = itc::fill(id, event);
+        // fill never shrinks the tree, so it made progress iff it is not <= the old one
+        event = !itc::leq(filled, event) ? filled : itc::grow(id, event).first;
+    }
+
+    // merge a peer's event tree (message receive)
+    void merge(const ItcEvent& other) { event = itc::join(event, other); }
+
+    // retire `other` into this worker, reclaiming its id
+    void absorb(const ItcStamp& other) {
+        id = itc::sum(id, other.id);
+        event = itc::join(event, other.event);
+    }
+
+    bool leq(const ItcStamp& other) const { return itc::leq(event, other.event); }
+
+    std::vector<uint8_t> encode_event() const {
+        itc::BitWriter w;
+        itc::encode_event(event, w);
+        return w.bytes;
+    }
+
+    std::vector<uint8_t> encode() const {
+        itc::BitWriter w;
+        itc::encode_id(id, w);
+        itc::encode_event(event, w);
+        return w.bytes;
+    }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+// Sustained-load driver shared by the clock simulations.
+// Each rank drains every pending message per tick with MPI_Improbe/MPI_Mrecv,
+// sends clock messages at a target rate to random peers for a fixed duration,
+// then reports aggregate events/sec and clock-merge latency percentiles.
+
+#include <mpi.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LoadOptions {
+    bool enabled = false;
+    double rate = 1000;     // messages per second per rank
+    double seconds = 5;
+};
+
+// parses "load [msgs/sec] [seconds]" starting at argv[first]
+inline LoadOptions parse_load_options(int argc, char** argv, int first) {
+    LoadOptions opt;
+    if (argc > first && std::string(argv[first]) == "load") {
+        opt.enabled = true;
+        if (argc > first + 1) opt.rate = atof(argv[first + 1]);
+        if (argc > first + 2) opt.seconds = atof(argv[first + 2]);
+    }
+    return opt;
+}
+
+inline double percentile(const std::vector<float>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+    return sorted[idx];
+}
+
+// on_send(dest, out) ticks the clock and fills the payload for dest;
+// on_receive(source, buf, count) merges a received payload and is timed.
+template <typename T, typename Send, typename Receive>
+void run_load(int rank, int size, MPI_Datatype type, const LoadOptions& opt, const std::string& label,
+              Send on_send, Receive on_receive) {
+    const int TAG = 0;
+    const int MAX_BURST = 64;
+
+    std::vector<std::vector<T>> send_buffers;
+    std::vector<MPI_Request> send_requests;
+    std::vector<int> free_slots, done_slots(1);
+    std::vector<int> sent_to(size, 0);
+    std::vector<T> recv_buffer;
+    std::vector<float> merge_ns;
+    long long sent = 0, received = 0, bytes_sent = 0;
+    srand(time(NULL) + rank);
+
+    auto drain = [&]() {
+        bool any = false;
+        while (true) {
+            int flag = 0;
+            MPI_Message msg;
+            MPI_Status status;
+            MPI_Improbe(MPI_ANY_SOURCE, TAG, MPI_COMM_WORLD, &flag, &msg, &status);
+            if (!flag) break;
+            int count = 0;
+            MPI_Get_count(&status, type, &count);
+            if ((int)recv_buffer.size() < count) recv_buffer.resize(count);
+            MPI_Mrecv(recv_buffer.data(), count, type, &msg, MPI_STATUS_IGNORE);
+
+            auto t0 = std::chrono::steady_clock::now();
+            on_receive(status.MPI_SOURCE, recv_buffer, count);
+            auto t1 = std::chrono::steady_clock::now();
+            merge_ns.push_back(std::chrono::duration<float, std::nano>(t1 - t0).count());
+            received++;
+            any = true;
+        }
+        return any;
+    };
+
+    auto reclaim = [&]() {
+        if (send_requests.empty()) return;
+        done_slots.resize(send_requests.size());
+        int outcount = 0;
+        MPI_Testsome(send_requests.size(), send_requests.data(), &outcount, done_slots.data(), MPI_STATUSES_IGNORE);
+        for (int k = 0; k < outcount && outcount != MPI_UNDEFINED; ++k) free_slots.push_back(done_slots[k]);
+    };
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    while (elapsed < opt.seconds) {
+        bool busy = drain();
+        reclaim();
+
+        long long due = (long long)(elapsed * opt.rate) - sent;
+        for (int b = 0; b < due && b < MAX_BURST; ++b) {
+            int dest;
+            do { dest = rand() % size; } while (dest == rank);
+
+            int slot;
+            if (free_slots.empty()) {
+                slot = send_buffers.size();
+                send_buffers.emplace_back();
+                send_requests.push_back(MPI_REQUEST_NULL);
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            on_send(dest, send_buffers[slot]);
+            MPI_Isend(send_buffers[slot].data(), send_buffers[slot].size(), type, dest, TAG, MPI_COMM_WORLD, &send_requests[slot]);
+            sent++;
+            sent_to[dest]++;
+            bytes_sent += send_buffers[slot].size() * sizeof(T);
+            busy = true;
+        }
+        if (!busy) std::this_thread::yield();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // finish own sends while still draining, then drain until every message
+    // addressed to this rank has arrived
+    int all_sent = 0;
+    while (!all_sent) {
+        drain();
+        MPI_Testall(send_requests.size(), send_requests.data(), &all_sent, MPI_STATUSES_IGNORE);
+    }
+    int expected = 0;
+    MPI_Reduce_scatter_block(sent_to.data(), &expected, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    while (received < expected) {
+        if (!drain()) std::this_thread::yield();
+    }
+
+    long long local[3] = {sent, received, bytes_sent}, total[3];
+    MPI_Reduce(local, total, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    double max_elapsed = 0;
+    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    int n_samples = merge_ns.size();
+    std::vector<int> counts(size), displs(size);
+    MPI_Gather(&n_samples, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<float> all_ns;
+    if (rank == 0) {
+        int sum = 0;
+        for (int r = 0; r < size; ++r) { displs[r] = sum; sum += counts[r]; }
+        all_ns.resize(sum);
+    }
+    MPI_Gatherv(merge_ns.data(), n_samples, MPI_FLOAT, all_ns.data(), counts.data(), displs.data(), MPI_FLOAT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        std::sort(all_ns.begin(), all_ns.end());
+        std::cout << "--- Load Results (" << label << ") ---" << std::endl;
+        std::cout << "ranks: " << size << ", target rate: " << opt.rate << " msgs/sec/rank, duration: "
+                  << max_elapsed << " s" << std::endl;
+        std::cout << "messages sent: " << total[0] << ", received: " << total[1]
+                  << ", avg bytes/msg: " << (total[0] ? (double)total[2] / total[0] : 0) << std::endl;
+        std::cout << "events/sec: " << (total[0] + total[1]) / max_elapsed << std::endl;
+        std::cout << std::fixed << std::setprecision(1)
+                  << "merge latency ns: p50 " << percentile(all_ns, 0.50) << ", p99 " << percentile(all_ns, 0.99)
+                  << ", p999 " << percentile(all_ns, 0.999) << ", max " << (all_ns.empty() ? 0 : all_ns.back())
+                  << std::defaultfloat << std::endl;
+    }
+}
@@ -1,6 +1,8 @@
 #include <mpi.h>
 #include <bits/stdc++.h> 
 #include <unistd.h>   
+#include "load_driver.h"
+#include "rank_log.h"
 
 using namespace std;
 
@@ -18,13 +20,96 @@ void print_logical_clock(int rank, int clock, const string& message) {
     cout << "[Rank " << rank << "] " << message << " LC: " << clock << endl;
 }
 
+// Hybrid Logical Clock packed into one 64-bit word:
+// upper 48 bits physical time in ms, lower 16 bits logical counter.
+// Packed values compare like the (l, c) pairs they encode.
+const int HLC_LOGICAL_BITS = 16;
+const uint64_t HLC_LOGICAL_MASK = (1ULL << HLC_LOGICAL_BITS) - 1;
+const uint64_t HLC_NONE = UINT64_MAX;
+const uint64_t HLC_MAX_DRIFT_MS = 1000;   // remote clocks further ahead than this are reported
+long long hlc_drift_violations = 0;
+
+inline uint64_t hlc_physical(uint64_t hlc) { return hlc >> HLC_LOGICAL_BITS; }
+inline uint64_t hlc_logical(uint64_t hlc) { return hlc & HLC_LOGICAL_MASK; }
+
+// wall-clock milliseconds, 48 bits are enough until the year 10889
+inline uint64_t physical_ms() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// update hybrid logical clock fxn (local/send event when received_hlc is HLC_NONE)
+// returns false when the received clock is beyond the drift bound; it is still
+// merged, since a receive must never be timestamped before its send
+bool update_hlc(uint64_t& hlc, uint64_t received_hlc = HLC_NONE) {
+    uint64_t pt = physical_ms() << HLC_LOGICAL_BITS;
+    bool within_bound = true;
+
+    if (received_hlc != HLC_NONE && hlc_physical(received_hlc) > hlc_physical(pt) + HLC_MAX_DRIFT_MS) {
+        hlc_drift_violations++;
+        within_bound = false;
+    }
+
+    // packed max keeps (l, c) of the larger clock; pt has c = 0, so if the
+    // physical time wins the counter restarts, otherwise it advances by one
+    uint64_t next = max(hlc, received_hlc == HLC_NONE ? 0 : received_hlc);
+    if (pt > next) hlc = pt;
+    else if (hlc_logical(next) == HLC_LOGICAL_MASK) {
+        // counter exhausted within this ms: borrow the next millisecond
+        hlc = (hlc_physical(next) + 1) << HLC_LOGICAL_BITS;
+    }
+    else hlc = next + 1;
+    return within_bound;
+}
+
+// print hybrid logical clock fxn
+void print_hlc(int rank, uint64_t hlc, const string& message) {
+    cout << "[Rank " << rank << "] " << message << " HLC: " << hlc_physical(hlc) << "." << hlc_logical(hlc) << endl;
+}
+
+// timestamp generation and merge throughput: Lamport int clock vs packed HLC
+void run_benchmark() {
+    const long long OPS = 20000000;
+    cout << "--- Logical Clock Throughput Benchmark ---" << endl;
+    cout << "clock     Mticks/sec   Mmerges/sec" << endl;
+
+    int lc = 0;
+    auto t0 = chrono::steady_clock::now();
+    // the empty asm keeps the compiler from folding the int loops into one add
+    for (long long i = 0; i < OPS; ++i) { update_clock(lc, -1); asm volatile("" : "+r"(lc)); }
+    auto t1 = chrono::steady_clock::now();
+    for (long long i = 0; i < OPS; ++i) { update_clock(lc, lc - (int)(i & 0xFF)); asm volatile("" : "+r"(lc)); }
+    auto t2 = chrono::steady_clock::now();
+    cout << "lamport " << setw(12) << OPS / chrono::duration<double>(t1 - t0).count() / 1e6
+         << " " << setw(13) << OPS / chrono::duration<double>(t2 - t1).count() / 1e6 << endl;
+
+    uint64_t hlc = 0;
+    t0 = chrono::steady_clock::now();
+    for (long long i = 0; i < OPS; ++i) { update_hlc(hlc); asm volatile("" : "+r"(hlc)); }
+    t1 = chrono::steady_clock::now();
+    for (long long i = 0; i < OPS; ++i) { update_hlc(hlc, hlc - (i & 0xFF)); asm volatile("" : "+r"(hlc)); }
+    t2 = chrono::steady_clock::now();
+    cout << "hlc     " << setw(12) << OPS / chrono::duration<double>(t1 - t0).count() / 1e6
+         << " " << setw(13) << OPS / chrono::duration<double>(t2 - t1).count() / 1e6 << endl;
+}
+
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int world_rank, world_size;
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+    // usage: logical_clock [lamport|hlc|bench] [load <msgs/sec> <seconds>]
+    string mode = argc > 1 ? argv[1] : "lamport";
+    if (mode == "bench") {
+        if (world_rank == 0) run_benchmark();
+        MPI_Finalize();
+        return 0;
+    }
+    const bool hybrid = (mode == "hlc");
+    const LoadOptions load = parse_load_options(argc, argv, 2);
+
     if (world_size < 2) {
         if (world_rank == 0) {
             cerr << "This program requires at least 2 processes." << endl;
@@ -34,11 +119,37 @@ int main(int argc, char** argv) {
     }
 
     int logical_clock = 0;
+    uint64_t hlc = 0;
+
+    if (load.enabled && hybrid) {
+        run_load<uint64_t>(world_rank, world_size, MPI_UINT64_T, load, "hybrid logical clock",
+            [&](int, vector<uint64_t>& out) { update_hlc(hlc); out.assign(1, hlc); },
+            [&](int, const vector<uint64_t>& buf, int) { update_hlc(hlc, buf[0]); });
+        if (hlc_drift_violations > 0) {
+            cout << "[Rank " << world_rank << "] WARNING: merged " << hlc_drift_violations << " clocks beyond the "
+                 << HLC_MAX_DRIFT_MS << " ms drift bound." << endl;
+        }
+        MPI_Finalize();
+        return 0;
+    }
+    if (load.enabled) {
+        run_load<int>(world_rank, world_size, MPI_INT, load, "lamport clock",
+            [&](int, vector<int>& out) { update_clock(logical_clock, -1); out.assign(1, logical_clock); },
+            [&](int, const vector<int>& buf, int) { update_clock(logical_clock, buf[0]); });
+        MPI_Finalize();
+        return 0;
+    }
+
+    RankLog event_log("logical_clock", world_rank);
+    deque<int> send_clocks;         // Isend buffers stay alive until the final Waitall
+    deque<uint64_t> send_hlcs;
+    vector<MPI_Request> send_requests;
     srand(time(NULL) + world_rank);
 
     MPI_Barrier(MPI_COMM_WORLD);
     if (world_rank == 0) {
-        cout << "--- Lamport Logical Clock Simulation Starting ---" << endl;
+        cout << "--- " << (hybrid ? "Hybrid" : "Lamport") << " Logical Clock Simulation Starting ---" << endl;
+        cout << "Per-event log: logical_clock.rank<N>.log" << endl;
     }
     MPI_Barrier(MPI_COMM_WORLD);
 
@@ -50,34 +161,58 @@ int main(int argc, char** argv) {
         MPI_Status status;
         MPI_Iprobe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &flag, &status);
 
-        if (flag) {
+        if (flag && hybrid) {
+            uint64_t received_hlc;
+            int source_rank = status.MPI_SOURCE;
+            MPI_Recv(&received_hlc, 1, MPI_UINT64_T, source_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            RLOG(LOG_INFO, EV_RECV, "Received clock from Rank {peer}. HLC: {clock}.{a}", source_rank, 0,
+                 hlc_physical(received_hlc), hlc_logical(received_hlc));
+            if (!update_hlc(hlc, received_hlc))
+                RLOG(LOG_WARN, EV_STATE, "Clock from Rank {peer} is more than {a} ms ahead of local time; merged anyway", source_rank, 0,
+                     hlc_physical(received_hlc), HLC_MAX_DRIFT_MS);
+            RLOG(LOG_INFO, EV_STATE, "Updated after receive. HLC: {clock}.{a}", -1, -1, hlc_physical(hlc), hlc_logical(hlc));
+        }
+        else if (flag) {
             int received_clock;
             int source_rank = status.MPI_SOURCE;
             MPI_Recv(&received_clock, 1, MPI_INT, source_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            cout << "[Rank " << world_rank << "] Received clock value " << received_clock << " from Rank " << source_rank << "." << endl;
+            RLOG(LOG_INFO, EV_RECV, "Received clock value {clock} from Rank {peer}.", source_rank, 0, received_clock);
             update_clock(logical_clock, received_clock);
-            print_logical_clock(world_rank, logical_clock, "Updated after receive.");
+            RLOG(LOG_INFO, EV_STATE, "Updated after receive. LC: {clock}", -1, -1, logical_clock);
         }
 
         int action_choice = rand() % 3; 
 
         if (action_choice == 0) { // Send event
-            update_clock(logical_clock,-1); 
             int dest_rank;
             do {
                 dest_rank = rand() % world_size;
             } while (dest_rank == world_rank);
-            MPI_Request send_request;
-            MPI_Isend(&logical_clock, 1, MPI_INT, dest_rank, 0, MPI_COMM_WORLD, &send_request);
-            print_logical_clock(world_rank, logical_clock, "Sent to Rank " + to_string(dest_rank) + ".");
+            send_requests.emplace_back();
+            if (hybrid) {
+                update_hlc(hlc);
+                send_hlcs.push_back(hlc);
+                MPI_Isend(&send_hlcs.back(), 1, MPI_UINT64_T, dest_rank, 0, MPI_COMM_WORLD, &send_requests.back());
+                RLOG(LOG_INFO, EV_SEND, "Sent to Rank {peer}. HLC: {clock}.{a}", dest_rank, 0, hlc_physical(hlc), hlc_logical(hlc));
+            } else {
+                update_clock(logical_clock,-1); 
+                send_clocks.push_back(logical_clock);
+                MPI_Isend(&send_clocks.back(), 1, MPI_INT, dest_rank, 0, MPI_COMM_WORLD, &send_requests.back());
+                RLOG(LOG_INFO, EV_SEND, "Sent to Rank {peer}. LC: {clock}", dest_rank, 0, logical_clock);
+            }
 
         } 
+        else if (hybrid) { // Internal event
+            update_hlc(hlc);
+            RLOG(LOG_INFO, EV_INTERNAL, "Internal event.        HLC: {clock}.{a}", -1, -1, hlc_physical(hlc), hlc_logical(hlc));
+        }
         else { // Internal event
             update_clock(logical_clock,-1); 
-            print_logical_clock(world_rank, logical_clock, "Internal event.       ");
+            RLOG(LOG_INFO, EV_INTERNAL, "Internal event.        LC: {clock}", -1, -1, logical_clock);
         }
     }
 
+    MPI_Waitall(send_requests.size(), send_requests.data(), MPI_STATUSES_IGNORE);
     MPI_Barrier(MPI_COMM_WORLD);
     if (world_rank == 0) {
         cout << "\n--- Simulation Finished ---" << endl;
@@ -86,7 +221,14 @@ int main(int argc, char** argv) {
 
     for (int rank = 0; rank < world_size; ++rank) {
         if (world_rank == rank) {
-            print_logical_clock(world_rank, logical_clock, "Final State.          ");
+            if (hybrid) {
+                print_hlc(world_rank, hlc, "Final State.          ");
+                if (hlc_drift_violations > 0) {
+                    cout << "[Rank " << world_rank << "] WARNING: merged " << hlc_drift_violations << " clocks beyond the "
+                         << HLC_MAX_DRIFT_MS << " ms drift bound." << endl;
+                }
+            }
+            else print_logical_clock(world_rank, logical_clock, "Final State.          ");
         }
         MPI_Barrier(MPI_COMM_WORLD);
     }
@@ -1,57 +1,479 @@
 #include <mpi.h>
 #include <bits/stdc++.h>
 #include <unistd.h>
+#include "clock_kernels.h"
+#include "load_driver.h"
+#include "rank_log.h"
 
 using namespace std;
 
+// flat row-major N x N matrix clock, contiguous so it can go straight to MPI
+struct MatrixClock {
+    int n = 0;
+    vector<int> cells;
+
+    MatrixClock(int size) : n(size), cells((size_t)size * size, 0) {}
+    int* row(int i) { return cells.data() + (size_t)i * n; }
+    const int* row(int i) const { return cells.data() + (size_t)i * n; }
+    int& at(int i, int j) { return cells[(size_t)i * n + j]; }
+    int at(int i, int j) const { return cells[(size_t)i * n + j]; }
+};
+
+// per-destination row tracking for row-delta sends: row_update[i] is my own
+// entry when row i last changed, last_sent[j] my own entry at the last send to j
+struct RowDeltaState {
+    vector<int> last_sent;
+    vector<int> row_update;
+};
+
 // print matrix clock fxn
-void print_matrix_clock(const vector<vector<int>>& clock, int size, int rank, const string& message) {
+void print_matrix_clock(const MatrixClock& clock, int size, int rank, const string& message) {
     cout << "[Rank " << rank << "] " << message << "\n";
     cout << "  [";
     for (int i = 0; i < size; ++i) {
         if (i > 0) cout << "   ";
         cout << "[";
         for (int j = 0; j < size; ++j) {
-            cout << setw(3) << clock[i][j] << (j == size - 1 ? "" : ",");
+            cout << setw(3) << clock.at(i, j) << (j == size - 1 ? "" : ",");
         }
         cout << "]" << (i == size - 1 ? "" : ",\n");
     }
     cout << "]" << endl;
 }
 
-// update matrix clock fxn
-void update_clock(vector<vector<int>>& local_clock, int rank, int size, const vector<vector<int>>* received_clock = nullptr) {
-    local_clock[rank][rank]++;
+// update matrix clock fxn; on receive the sender's own row is also merged
+// into ours, so our row stays our vector clock
+void update_clock(MatrixClock& local_clock, int rank, int size, const int* received_clock = nullptr, int source = -1) {
+    local_clock.at(rank, rank)++;
 
     if (received_clock != nullptr) {
-        for (int i = 0; i < size; ++i) {
-            for (int j = 0; j < size; ++j) {
-                local_clock[i][j] = max(local_clock[i][j], (*received_clock)[i][j]);
+        clock_max_merge(local_clock.cells.data(), received_clock, (size_t)size * size);
+        clock_max_merge(local_clock.row(rank), received_clock + (size_t)source * size, size);
+    }
+}
+
+// encode rows changed since the last send to dest as [row, n values]...
+void encode_row_delta(const MatrixClock& clock, int rank, int dest, RowDeltaState& rs, vector<int>& out) {
+    out.clear();
+    for (int i = 0; i < clock.n; ++i) {
+        if (rs.row_update[i] > rs.last_sent[dest]) {
+            out.push_back(i);
+            out.insert(out.end(), clock.row(i), clock.row(i) + clock.n);
+        }
+    }
+    rs.last_sent[dest] = clock.at(rank, rank);
+}
+
+// update matrix clock from a row-delta message, only touching the rows it carries
+void update_clock_rows(MatrixClock& local_clock, int rank, int source, const int* msg, int num_ints, RowDeltaState& rs) {
+    local_clock.at(rank, rank)++;
+    rs.row_update[rank] = local_clock.at(rank, rank);
+
+    const int stride = local_clock.n + 1;
+    for (int p = 0; p + stride <= num_ints; p += stride) {
+        int i = msg[p];
+        if (clock_max_merge(local_clock.row(i), msg + p + 1, local_clock.n)) {
+            rs.row_update[i] = local_clock.at(rank, rank);
+        }
+        if (i == source) clock_max_merge(local_clock.row(rank), msg + p + 1, local_clock.n);
+    }
+}
+
+// min over column j: every process knows at least this many events of j,
+// so messages from j with a smaller timestamp are stable and can be dropped
+int column_min(const MatrixClock& clock, int j) {
+    int m = INT_MAX;
+    for (int i = 0; i < clock.n; ++i) m = min(m, clock.at(i, j));
+    return m;
+}
+
+// sparse matrix clock: the own row is dense (it is this rank's vector clock),
+// every other row is stored only once something about it has been learned,
+// as a sorted (col, value) list or, once at least half full, as n plain values.
+// Row i is always a copy of some past version of process i's own row and
+// M[i][i] names that version, so a merge skips every received row whose
+// diagonal is not newer and replaces the others outright.
+struct SparseMatrixClock {
+    struct Row {
+        int diag = 0;
+        bool dense = false;
+        vector<int> entries;   // dense: n values; sparse: col, value, col, value, ...
+    };
+
+    int n = 0, rank = 0;
+    vector<int> own;
+    vector<int> slot;          // row -> index into rows, -1 if not learned
+    vector<Row> rows;
+
+    SparseMatrixClock(int size, int r) : n(size), rank(r), own(size, 0), slot(size, -1) {}
+
+    int diag(int i) const {
+        if (i == rank) return own[rank];
+        return slot[i] < 0 ? 0 : rows[slot[i]].diag;
+    }
+
+    int at(int i, int j) const {
+        if (i == rank) return own[j];
+        if (slot[i] < 0) return 0;
+        const Row& row = rows[slot[i]];
+        if (row.dense) return row.entries[j];
+        const vector<int>& e = row.entries;
+        int lo = 0, hi = e.size() / 2;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (e[2 * mid] < j) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < (int)e.size() / 2 && e[2 * lo] == j ? e[2 * lo + 1] : 0;
+    }
+
+    // replace row i with version d if that is newer; nnz < 0 means `values`
+    // holds n plain values, otherwise nnz (col, value) pairs
+    bool learn_row(int i, int d, const int* values, int nnz) {
+        if (d <= diag(i)) return false;
+        if (slot[i] < 0) {
+            slot[i] = rows.size();
+            rows.emplace_back();
+        }
+        Row& row = rows[slot[i]];
+        row.diag = d;
+        row.dense = nnz < 0 || 2 * nnz >= n;
+        if (nnz < 0) {
+            row.entries.assign(values, values + n);
+        } else if (row.dense) {
+            row.entries.assign(n, 0);
+            for (int k = 0; k < nnz; ++k) row.entries[values[2 * k]] = values[2 * k + 1];
+        } else {
+            row.entries.assign(values, values + 2 * nnz);
+        }
+        return true;
+    }
+
+    int column_min(int j) const {
+        if ((int)rows.size() < n - 1) return 0;   // some row still all zero
+        int m = own[j];
+        for (int i = 0; i < n && m > 0; ++i) {
+            if (i != rank) m = min(m, at(i, j));
+        }
+        return m;
+    }
+
+    size_t bytes() const {
+        size_t b = sizeof(*this) + (own.capacity() + slot.capacity()) * sizeof(int) + rows.capacity() * sizeof(Row);
+        for (const Row& r : rows) b += r.entries.capacity() * sizeof(int);
+        return b;
+    }
+
+    MatrixClock to_dense() const {
+        MatrixClock m(n);
+        copy(own.begin(), own.end(), m.row(rank));
+        for (int i = 0; i < n; ++i) {
+            if (i == rank || slot[i] < 0) continue;
+            const Row& row = rows[slot[i]];
+            if (row.dense) {
+                copy(row.entries.begin(), row.entries.end(), m.row(i));
+                continue;
             }
+            for (size_t k = 0; k < row.entries.size(); k += 2) m.at(i, row.entries[k]) = row.entries[k + 1];
+        }
+        return m;
+    }
+};
+
+// encode the rows changed since the last send to dest as
+// [row, diag, nnz, (col, value) x nnz] or [row, diag, -1, n values]...
+void encode_sparse_delta(const SparseMatrixClock& clock, int dest, RowDeltaState& rs, vector<int>& out) {
+    out.clear();
+    for (int i = 0; i < clock.n; ++i) {
+        if (rs.row_update[i] <= rs.last_sent[dest]) continue;
+        if (i == clock.rank) {
+            out.push_back(i);
+            out.push_back(clock.own[i]);
+            out.push_back(-1);
+            out.insert(out.end(), clock.own.begin(), clock.own.end());
+        } else if (clock.slot[i] >= 0) {
+            const SparseMatrixClock::Row& row = clock.rows[clock.slot[i]];
+            out.push_back(i);
+            out.push_back(row.diag);
+            out.push_back(row.dense ? -1 : row.entries.size() / 2);
+            out.insert(out.end(), row.entries.begin(), row.entries.end());
+        }
+    }
+    rs.last_sent[dest] = clock.own[clock.rank];
+}
+
+// merge a sparse row-delta message: stale rows are skipped on their diagonal,
+// the sender's row is also folded into our own row
+void update_sparse(SparseMatrixClock& clock, int source, const int* msg, int num_ints, RowDeltaState& rs) {
+    clock.own[clock.rank]++;
+    rs.row_update[clock.rank] = clock.own[clock.rank];
+
+    for (int p = 0; p + 3 <= num_ints; ) {
+        int i = msg[p], d = msg[p + 1], nnz = msg[p + 2];
+        const int* values = msg + p + 3;
+        p += 3 + (nnz < 0 ? clock.n : 2 * nnz);
+        if (i == clock.rank) continue;   // our own row is always newer
+        if (clock.learn_row(i, d, values, nnz)) rs.row_update[i] = clock.own[clock.rank];
+        if (i == source) {
+            if (nnz < 0) {
+                clock_max_merge(clock.own.data(), values, clock.n);
+                continue;
+            }
+            for (int k = 0; k < nnz; ++k) {
+                int& v = clock.own[values[2 * k]];
+                v = max(v, values[2 * k + 1]);
+            }
+        }
+    }
+}
+
+// merge-time comparison of the old nested-vector layout and the flat SIMD one
+void run_benchmark() {
+    const int sizes[] = {16, 64, 128, 256, 512};
+    cout << "--- Matrix Clock Merge Benchmark ---" << endl;
+    cout << "    N   nested us/merge   flat us/merge   speedup" << endl;
+
+    for (int n : sizes) {
+        const int reps = max(4, 4000000 / (n * n));
+        vector<vector<int>> nested_a(n, vector<int>(n)), nested_b(n, vector<int>(n));
+        MatrixClock flat_a(n), flat_b(n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                nested_a[i][j] = flat_a.at(i, j) = rand() % 1000;
+                nested_b[i][j] = flat_b.at(i, j) = rand() % 1000;
+            }
+        }
+
+        auto t0 = chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            nested_b[r % n][0]++;
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    nested_a[i][j] = max(nested_a[i][j], nested_b[i][j]);
+                }
+            }
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) {
+            flat_b.at(r % n, 0)++;
+            clock_max_merge(flat_a.cells.data(), flat_b.cells.data(), flat_a.cells.size());
+        }
+        auto t2 = chrono::steady_clock::now();
+
+        for (int i = 0; i < n; ++i) {
+            if (!equal(nested_a[i].begin(), nested_a[i].end(), flat_a.row(i))) {
+                cerr << "Benchmark error: merge results differ at N=" << n << endl;
+                break;
+            }
+        }
+
+        double nested_us = chrono::duration<double, micro>(t1 - t0).count() / reps;
+        double flat_us = chrono::duration<double, micro>(t2 - t1).count() / reps;
+        cout << setw(5) << n << " " << setw(17) << nested_us << " " << setw(15) << flat_us
+             << " " << setw(9) << nested_us / flat_us << endl;
+    }
+}
+
+// sparse vs dense matrix clocks. N processes are simulated with sparse
+// clocks only; for sampled messages the dense equivalents are materialised
+// to time the dense merge on identical data and to check both agree.
+void run_sparse_benchmark() {
+    const int sizes[] = {64, 256, 1024};
+    const int MESSAGES_PER_PROCESS = 20;
+    const int DENSE_SAMPLES = 200;
+    const int NEIGHBOURS = 8;
+
+    cout << "--- Sparse vs Dense Matrix Clock ---" << endl;
+    cout << "pattern      N   dense KB/rank  sparse KB/rank  dense B/msg  sparse B/msg"
+            "  dense us/merge  sparse us/merge  dense us/colmin  sparse us/colmin" << endl;
+
+    for (int pattern = 0; pattern < 2; ++pattern) {
+        for (int n : sizes) {
+            if (pattern == 0 && n > 256) {
+                // random gossip teaches every rank every row, so each simulated
+                // clock ends up dense; N of them do not fit in one address space
+                cout << "random    " << setw(5) << n << "   (skipped: every row is learned, sparse degenerates to dense)" << endl;
+                continue;
+            }
+            mt19937 rng(99 + n);
+            vector<SparseMatrixClock> clocks;
+            for (int r = 0; r < n; ++r) clocks.emplace_back(n, r);
+            vector<RowDeltaState> rs(n, {vector<int>(n, 0), vector<int>(n, 0)});
+            vector<int> msg;
+
+            const long long messages = (long long)MESSAGES_PER_PROCESS * n;
+            const long long sample_every = max(1LL, messages / DENSE_SAMPLES);
+            long long sparse_ints = 0, samples = 0, mismatches = 0;
+            double sparse_us = 0, dense_us = 0;
+
+            for (long long m = 0; m < messages; ++m) {
+                int src = rng() % n, dest;
+                if (pattern == 0) {
+                    do { dest = rng() % n; } while (dest == src);
+                } else {
+                    int off = (int)(rng() % NEIGHBOURS) - NEIGHBOURS / 2;
+                    if (off >= 0) off++;
+                    dest = ((src + off) % n + n) % n;
+                }
+
+                clocks[src].own[src]++;
+                rs[src].row_update[src] = clocks[src].own[src];
+                encode_sparse_delta(clocks[src], dest, rs[src], msg);
+                sparse_ints += msg.size();
+
+                const bool sample = m % sample_every == 0;
+                MatrixClock dense_dest(0), dense_src(0);
+                if (sample) {
+                    dense_dest = clocks[dest].to_dense();
+                    dense_src = clocks[src].to_dense();
+                }
+
+                auto t0 = chrono::steady_clock::now();
+                update_sparse(clocks[dest], src, msg.data(), msg.size(), rs[dest]);
+                auto t1 = chrono::steady_clock::now();
+                sparse_us += chrono::duration<double, micro>(t1 - t0).count();
+
+                if (sample) {
+                    auto t2 = chrono::steady_clock::now();
+                    update_clock(dense_dest, dest, n, dense_src.cells.data(), src);
+                    auto t3 = chrono::steady_clock::now();
+                    dense_us += chrono::duration<double, micro>(t3 - t2).count();
+                    samples++;
+                    mismatches += dense_dest.cells != clocks[dest].to_dense().cells;
+                }
+            }
+            if (mismatches) cerr << "Benchmark error: sparse and dense clocks differ at N=" << n << endl;
+
+            // memory, and the GC stability query over every column of a few ranks
+            double sparse_bytes = 0;
+            for (const SparseMatrixClock& c : clocks) sparse_bytes += c.bytes();
+            const int QUERY_RANKS = 4;
+            long long sink = 0;
+            double sparse_q = 0, dense_q = 0;
+            for (int q = 0; q < QUERY_RANKS; ++q) {
+                const SparseMatrixClock& c = clocks[q * n / QUERY_RANKS];
+                MatrixClock d = c.to_dense();
+                auto t0 = chrono::steady_clock::now();
+                for (int j = 0; j < n; ++j) sink += c.column_min(j);
+                auto t1 = chrono::steady_clock::now();
+                for (int j = 0; j < n; ++j) sink -= column_min(d, j);
+                auto t2 = chrono::steady_clock::now();
+                sparse_q += chrono::duration<double, micro>(t1 - t0).count();
+                dense_q += chrono::duration<double, micro>(t2 - t1).count();
+            }
+            if (sink != 0) cerr << "Benchmark error: column minimums differ at N=" << n << endl;
+
+            stringstream ss;
+            ss << (pattern == 0 ? "random   " : "neighbour") << " " << setw(5) << n << " "
+               << setw(15) << (double)n * n * sizeof(int) / 1024 << " "
+               << setw(15) << sparse_bytes / n / 1024 << " "
+               << setw(12) << (double)n * n * sizeof(int) << " "
+               << setw(13) << (double)sparse_ints * sizeof(int) / messages << " "
+               << setw(15) << dense_us / samples << " "
+               << setw(16) << sparse_us / messages << " "
+               << setw(16) << dense_q / (QUERY_RANKS * n) << " "
+               << setw(17) << sparse_q / (QUERY_RANKS * n);
+            cout << ss.str() << endl;
         }
     }
 }
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int world_rank, world_size;
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+    // usage: matrix_clock [full|rows|sparse|bench] [load <msgs/sec> <seconds>]
+    string mode = argc > 1 ? argv[1] : "full";
+    if (mode == "bench") {
+        if (world_rank == 0) {
+            run_benchmark();
+            run_sparse_benchmark();
+        }
+        MPI_Finalize();
+        return 0;
+    }
+    const bool row_delta = (mode == "rows");
+    const bool sparse = (mode == "sparse");
+    const LoadOptions load = parse_load_options(argc, argv, 2);
+
     if (world_size < 2) {
         if (world_rank == 0) cerr << "This program requires at least 2 processes." << endl;
         MPI_Finalize();
         return 1;
     }
 
-    vector<vector<int>> matrix_clock(world_size, vector<int>(world_size, 0));
+    MatrixClock matrix_clock(sparse ? 0 : world_size);
+    SparseMatrixClock sparse_clock(sparse ? world_size : 0, world_rank);
+    RowDeltaState rs = {vector<int>(world_size, 0), vector<int>(world_size, 0)};
+    vector<int> recv_buffer(sparse ? 0 : (size_t)world_size * (world_size + 1));
+    vector<MPI_Request> send_requests;
+    vector<vector<int>> send_buffers;
     srand(time(NULL) + world_rank);
 
+    if (load.enabled) {
+        run_load<int>(world_rank, world_size, MPI_INT, load,
+            sparse ? "matrix clock, sparse" : row_delta ? "matrix clock, rows" : "matrix clock, full",
+            [&](int dest, vector<int>& out) {
+                if (sparse) {
+                    rs.row_update[world_rank] = ++sparse_clock.own[world_rank];
+                    encode_sparse_delta(sparse_clock, dest, rs, out);
+                    return;
+                }
+                update_clock(matrix_clock, world_rank, world_size);
+                rs.row_update[world_rank] = matrix_clock.at(world_rank, world_rank);
+                if (row_delta) encode_row_delta(matrix_clock, world_rank, dest, rs, out);
+                else out = matrix_clock.cells;
+            },
+            [&](int source, const vector<int>& buf, int count) {
+                if (sparse) update_sparse(sparse_clock, source, buf.data(), count, rs);
+                else if (row_delta) update_clock_rows(matrix_clock, world_rank, source, buf.data(), count, rs);
+                else update_clock(matrix_clock, world_rank, world_size, buf.data(), source);
+            });
+        MPI_Finalize();
+        return 0;
+    }
+
+    RankLog event_log("matrix_clock", world_rank);
     MPI_Barrier(MPI_COMM_WORLD);
-    if (world_rank == 0) cout << "--- Matrix Clock Simulation Starting ---" << endl;
+    if (world_rank == 0) {
+        cout << "--- Matrix Clock Simulation Starting ---" << endl;
+        cout << "Per-event log: matrix_clock.rank<N>.log" << endl;
+    }
     MPI_Barrier(MPI_COMM_WORLD);
 
+    auto own_entry = [&]() { return sparse ? sparse_clock.own[world_rank] : matrix_clock.at(world_rank, world_rank); };
+    auto tick = [&]() {
+        if (sparse) sparse_clock.own[world_rank]++;
+        else update_clock(matrix_clock, world_rank, world_size);
+        rs.row_update[world_rank] = own_entry();
+    };
+
+    int received = 0;
+    vector<int> sent_to(world_size, 0);
+    auto receive = [&](const MPI_Status& status) {
+        int source_rank = status.MPI_SOURCE;
+        int count = 0;
+        MPI_Get_count(&status, MPI_INT, &count);
+        if ((int)recv_buffer.size() < count) recv_buffer.resize(count);
+        MPI_Recv(recv_buffer.data(), count, MPI_INT, source_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        received++;
+        if (sparse) {
+            RLOG(LOG_INFO, EV_RECV, "Received {a} sparse clock ints from Rank {peer}.", source_rank, 0, 0, count);
+            update_sparse(sparse_clock, source_rank, recv_buffer.data(), count, rs);
+        } else if (row_delta) {
+            RLOG(LOG_INFO, EV_RECV, "Received {a} clock rows from Rank {peer}.", source_rank, 0, 0, count / (world_size + 1));
+            update_clock_rows(matrix_clock, world_rank, source_rank, recv_buffer.data(), count, rs);
+        } else {
+            RLOG(LOG_INFO, EV_RECV, "Received clock from Rank {peer}.", source_rank, 0);
+            update_clock(matrix_clock, world_rank, world_size, recv_buffer.data(), source_rank);
+        }
+        RLOG(LOG_INFO, EV_STATE, "Updated after receive. M[own][own]: {clock}", -1, -1, own_entry());
+    };
+
     const int NUM_ITERATIONS = 10;
     for (int i = 0; i < NUM_ITERATIONS; ++i) {
         usleep(10000 * (1 + (rand() % 50))); 
@@ -59,46 +481,65 @@ int main(int argc, char** argv) {
         int flag = 0;
         MPI_Status status;
         MPI_Iprobe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &flag, &status);
-
-        if (flag) {
-            vector<vector<int>> recv_buffer(world_size, vector<int>(world_size, 0));
-            int source_rank = status.MPI_SOURCE;
-            MPI_Recv(recv_buffer.data()->data(), world_size * world_size, MPI_INT, source_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            cout << "[Rank " << world_rank << "] Received clock from Rank " << source_rank << "." << endl;
-            update_clock(matrix_clock, world_rank, world_size, &recv_buffer);
-            print_matrix_clock(matrix_clock, world_size, world_rank, "Updated after receive.");
-        }
+        if (flag) receive(status);
 
         int action_choice = rand() % 3;
         if (action_choice == 0) { // Send event
-            update_clock(matrix_clock, world_rank, world_size);
+            tick();
             int dest_rank;
             do {
                 dest_rank = rand() % world_size;
             } while (dest_rank == world_rank);
 
-            MPI_Request send_request;
-            MPI_Isend(matrix_clock.data()->data(), world_size * world_size, MPI_INT, dest_rank, 0, MPI_COMM_WORLD, &send_request); 
-            print_matrix_clock(matrix_clock, world_size, world_rank, "Sent to Rank " + to_string(dest_rank) + ".");
+            // each Isend keeps its own buffer alive until the final Waitall
+            send_buffers.emplace_back();
+            if (sparse) encode_sparse_delta(sparse_clock, dest_rank, rs, send_buffers.back());
+            else if (row_delta) encode_row_delta(matrix_clock, world_rank, dest_rank, rs, send_buffers.back());
+            else send_buffers.back() = matrix_clock.cells;
+            send_requests.emplace_back();
+            MPI_Isend(send_buffers.back().data(), send_buffers.back().size(), MPI_INT, dest_rank, 0, MPI_COMM_WORLD, &send_requests.back());
+            sent_to[dest_rank]++;
+            RLOG(LOG_INFO, EV_SEND, "Sent {a} clock ints to Rank {peer}. M[own][own]: {clock}", dest_rank, 0,
+                 own_entry(), send_buffers.back().size());
 
         } 
         else { // Internal event
-            update_clock(matrix_clock, world_rank, world_size);
-            print_matrix_clock(matrix_clock, world_size, world_rank, "Internal event.");
+            tick();
+            RLOG(LOG_INFO, EV_INTERNAL, "Internal event. M[own][own]: {clock}", -1, -1, own_entry());
         }
     }
 
+    // receive every clock still addressed to this rank; a send above the eager
+    // limit only completes once its receiver has matched it
+    int expected = 0;
+    MPI_Reduce_scatter_block(sent_to.data(), &expected, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    while (received < expected) {
+        MPI_Status status;
+        MPI_Probe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &status);
+        receive(status);
+    }
+    MPI_Waitall(send_requests.size(), send_requests.data(), MPI_STATUSES_IGNORE);
     MPI_Barrier(MPI_COMM_WORLD);
     if (world_rank == 0) cout << "\n--- Simulation Finished ---" << endl;
     MPI_Barrier(MPI_COMM_WORLD);
 
     for (int rank = 0; rank < world_size; ++rank) {
         if (world_rank == rank) {
-            print_matrix_clock(matrix_clock, world_size, world_rank, "Final State.");
+            if (sparse) {
+                print_matrix_clock(sparse_clock.to_dense(), world_size, world_rank,
+                                   "Final State. (" + to_string(sparse_clock.bytes()) + " bytes sparse)");
+            } else {
+                print_matrix_clock(matrix_clock, world_size, world_rank, "Final State.");
+            }
+            cout << "  stable (min over column): [";
+            for (int j = 0; j < world_size; ++j) {
+                cout << (sparse ? sparse_clock.column_min(j) : column_min(matrix_clock, j)) << (j == world_size - 1 ? "" : ", ");
+            }
+            cout << "]" << endl;
         }
         MPI_Barrier(MPI_COMM_WORLD);
     }
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
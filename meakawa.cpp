@@ -1,12 +1,21 @@
 #include <mpi.h>
 #include <iostream>
+#include <iomanip>
 #include <vector>
-#include <queue> 
+#include <queue>
+#include <deque>
+#include <array>
 #include <utility>
 #include <algorithm>
+#include <functional>
 #include <chrono>
 #include <thread>
-#include <string> 
+#include <string>
+#include <memory>
+#include <random>
+#include "load_driver.h"
+#include "rank_log.h"
+#include "wire_msg.h"
 
 using namespace std;
 
@@ -16,268 +25,1286 @@ using namespace std;
 #define INQUIRE_TAG   12
 #define RELINQ_TAG    13
 #define RELEASE_TAG   14
+#define TOKEN_TAG     15
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+const int NUM_KINDS = 5;                 // message kinds, indexed by tag - REQ_TAG
+const char* KIND_NAMES[NUM_KINDS] = {"REQUEST", "YES", "INQUIRE", "RELINQUISH", "RELEASE"};
+const int PRINT_LIMIT = 16;              // quorums listed one per rank up to this N
 
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+// ---------------------------------------------------------------------------
+// Quorum (voting district) constructions for any N. Every construction puts a
+// process in its own quorum and makes every two quorums intersect, which is
+// all Maekawa's algorithm needs for mutual exclusion.
+//
+// grid  N processes row-major in a ceil(sqrt N)-column grid; a quorum is the
+//       process's row plus its column, about 2 sqrt N. A partial last row is
+//       fine: any full row meets every column.
+// fpp   lines of the finite projective plane of prime order q, the smallest
+//       with q^2 + q + 1 >= N: any two lines meet in exactly one point, so
+//       quorums are q + 1 ~ sqrt N. Each point is matched to a distinct line
+//       through it, so every process sits in q + 1 quorums. Points beyond N
+//       fold onto p mod N, which keeps every intersection.
+// tree  heap-ordered binary tree; a quorum is the path from the root through
+//       the process down to a leaf, about log2 N. Any two meet at the root,
+//       which therefore votes on every request.
 
-    const int NUM_PROCESSES = 6;
-    if (size != NUM_PROCESSES) {
-        if (rank == 0)
-            cerr << "Run with exactly " << NUM_PROCESSES << " processes.\n";
-        MPI_Finalize();
-        return 1;
-    }
+vector<vector<int>> grid_quorums(int n) {
+    int cols = 1;
+    while (cols * cols < n) cols++;
+    vector<vector<int>> quorums(n);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            if (j / cols == i / cols || j % cols == i % cols) quorums[i].push_back(j);
+    return quorums;
+}
+
+bool is_prime(int q) {
+    if (q < 2) return false;
+    for (int d = 2; d * d <= q; ++d)
+        if (q % d == 0) return false;
+    return true;
+}
+
+vector<vector<int>> fpp_quorums(int n) {
+    int q = 2;
+    while (!is_prime(q) || q * q + q + 1 < n) q++;
 
-    // voting districts
-    vector<vector<int>> S = {
-        {0,1,2,3}, {0,1,2,4}, {0,1,2,5}, {0,3,4,5}, {1,3,4,5}, {2,3,4,5}
+    // points and lines of PG(2, q) are the same normalized triples (first nonzero coordinate 1)
+    vector<array<int, 3>> triples;
+    for (int y = 0; y < q; ++y)
+        for (int z = 0; z < q; ++z) triples.push_back({1, y, z});
+    for (int z = 0; z < q; ++z) triples.push_back({0, 1, z});
+    triples.push_back({0, 0, 1});
+    const int m = triples.size();
+
+    vector<vector<int>> points_on(m), lines_through(m);
+    for (int l = 0; l < m; ++l)
+        for (int p = 0; p < m; ++p) {
+            const array<int, 3>& a = triples[l];
+            const array<int, 3>& x = triples[p];
+            if ((a[0] * x[0] + a[1] * x[1] + a[2] * x[2]) % q == 0) {
+                points_on[l].push_back(p);
+                lines_through[p].push_back(l);
+            }
+        }
+
+    // perfect matching point -> incident line (augmenting paths; the incidence graph is (q+1)-regular)
+    vector<int> line_of(m, -1), point_of(m, -1), seen(m, -1);
+    function<bool(int, int)> augment = [&](int p, int round) {
+        for (int l : lines_through[p]) {
+            if (seen[l] == round) continue;
+            seen[l] = round;
+            if (point_of[l] < 0 || augment(point_of[l], round)) {
+                point_of[l] = p;
+                line_of[p] = l;
+                return true;
+            }
+        }
+        return false;
     };
-    vector<int> mySet = S[rank];
+    for (int p = 0; p < m; ++p) augment(p, p);
 
-    int Ts = 0;                          
-    int Yes_votes = 0;                  
-    bool WantCS = false;               
-    bool HaveVoted = false;             
-    int Candidate = -1;                 
-    int Candidate_Ts = 0;
-    bool HaveInquired = false;           
+    vector<vector<int>> quorums(n);
+    for (int i = 0; i < n; ++i) {
+        for (int p : points_on[line_of[i]]) quorums[i].push_back(p % n);
+        sort(quorums[i].begin(), quorums[i].end());
+        quorums[i].erase(unique(quorums[i].begin(), quorums[i].end()), quorums[i].end());
+    }
+    return quorums;
+}
 
+vector<vector<int>> tree_quorums(int n) {
+    vector<vector<int>> quorums(n);
+    for (int i = 0; i < n; ++i) {
+        for (int v = i; v > 0; v = (v - 1) / 2) quorums[i].push_back(v);
+        quorums[i].push_back(0);
+        for (int v = 2 * i + 1; v < n; v = 2 * v + 1) quorums[i].push_back(v);
+        sort(quorums[i].begin(), quorums[i].end());
+        quorums[i].erase(unique(quorums[i].begin(), quorums[i].end()), quorums[i].end());
+    }
+    return quorums;
+}
+
+// empty for an unknown construction
+vector<vector<int>> build_quorums(const string& kind, int n) {
+    if (kind == "grid") return grid_quorums(n);
+    if (kind == "fpp") return fpp_quorums(n);
+    if (kind == "tree") return tree_quorums(n);
+    return {};
+}
+
+struct QuorumReport {
+    int min_size = 0, max_size = 0;
+    double avg_size = 0;
+    int max_load = 0;            // most quorums any one process belongs to
+    bool self_member = true;     // every process is in its own quorum
+    bool intersecting = true;    // every pair of quorums shares a process
+};
+
+QuorumReport check_quorums(const vector<vector<int>>& quorums) {
+    const int n = quorums.size();
+    const int words = (n + 63) / 64;
+    QuorumReport r;
+    r.min_size = n;
+    vector<uint64_t> bits((size_t)n * words, 0);
+    vector<int> load(n, 0);
+    for (int i = 0; i < n; ++i) {
+        const vector<int>& q = quorums[i];
+        r.min_size = min(r.min_size, (int)q.size());
+        r.max_size = max(r.max_size, (int)q.size());
+        r.avg_size += (double)q.size() / n;
+        r.self_member &= binary_search(q.begin(), q.end(), i);
+        for (int p : q) {
+            bits[(size_t)i * words + p / 64] |= 1ULL << (p % 64);
+            load[p]++;
+        }
+    }
+    r.max_load = n ? *max_element(load.begin(), load.end()) : 0;
+    for (int i = 0; i < n && r.intersecting; ++i)
+        for (int j = i + 1; j < n && r.intersecting; ++j) {
+            bool meet = false;
+            for (int w = 0; w < words && !meet; ++w) meet = bits[(size_t)i * words + w] & bits[(size_t)j * words + w];
+            r.intersecting = meet;
+        }
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// What the workload driver and the simulator need from a mutual-exclusion
+// engine. An engine sends through `transmit` and counts what it sends by
+// message kind. The driver hands it every message addressed to its process,
+// polls ready(), and brackets the CS with enter() and release().
+
+struct DmeEngine {
+    function<void(int dest, const WireMsg& m, const int32_t* payload, int length)> transmit;
+    long long sent[NUM_KINDS] = {};     // messages to other processes, by kind
+    long long free_entries = 0;         // entries granted without sending anything
+
+    virtual ~DmeEngine() {}
+    virtual const char* name() const = 0;
+    virtual int num_kinds() const = 0;
+    virtual const char* kind_name(int k) const = 0;
+    virtual void request() = 0;
+    virtual bool ready() const = 0;
+    virtual void enter() = 0;
+    virtual void release() = 0;
+    virtual void on_message(const WireMsg& m, const int32_t* payload) = 0;
+};
+
+// ---------------------------------------------------------------------------
+// One process's Maekawa state, as requester and as voter. Messages to other
+// processes go through `transmit`. Messages to itself are queued locally,
+// since a process votes on its own requests like any other voter. Every
+// message carries one timestamp: REQUEST its own, the others the timestamp
+// of the request they refer to, so an INQUIRE or YES left over from an
+// earlier request is recognised and ignored.
+
+struct MaekawaNode : DmeEngine {
+    int rank = 0;
+    vector<int> mySet;                                   // sorted, contains rank
+
+    // requester
+    int Ts = 0;
+    int Request_Ts = 0;
+    int Yes_votes = 0;
+    bool WantCS = false;
+    bool inCS = false;
+    vector<char> granted;                                // parallel to mySet
+
+    // voter
+    bool HaveVoted = false;
+    int Candidate = -1;
+    int Candidate_Ts = 0;
+    bool HaveInquired = false;
     priority_queue<pair<int,int>, vector<pair<int,int>>, greater<pair<int,int>>> WaitingQ;
 
-    auto sendInt = [&](int dest, int tag, int value){
-        MPI_Send(&value, 1, MPI_INT, dest, tag, MPI_COMM_WORLD);
+    deque<pair<int,int>> local;                          // (tag, ts) sent to self
+
+    MaekawaNode(int r, const vector<int>& quorum) : rank(r), mySet(quorum), granted(quorum.size(), 0) {}
+
+    const char* name() const override { return "Maekawa"; }
+    int num_kinds() const override { return NUM_KINDS; }
+    const char* kind_name(int k) const override { return KIND_NAMES[k]; }
+
+    bool ready() const override { return WantCS && !inCS && Yes_votes == (int)mySet.size(); }
+
+    void request() override {
+        Ts++;
+        WantCS = true;
+        Request_Ts = Ts;
+        Yes_votes = 0;
+        fill(granted.begin(), granted.end(), 0);
+        RLOG(LOG_DEBUG, EV_SEND, "Wants CS. Broadcasting REQUEST to voting set (ts={clock})", -1, REQ_TAG, Ts);
+        for (int member : mySet) post(member, REQ_TAG, Request_Ts);
+        flush_local();
+    }
+
+    void enter() override { inCS = true; }
+
+    void release() override {
+        WantCS = false;
+        inCS = false;
+        Yes_votes = 0;
+        RLOG(LOG_DEBUG, EV_SEND, "Leaving CS. Sending RELEASE to voting set", -1, RELEASE_TAG, Ts);
+        for (int member : mySet) post(member, RELEASE_TAG, Request_Ts);
+        flush_local();
+    }
+
+    void on_message(const WireMsg& m, const int32_t*) override {
+        handle(m.sender, m.tag, m.ts);
+        flush_local();
+    }
+
+private:
+    void post(int dest, int tag, int ts) {
+        if (dest == rank) local.push_back({tag, ts});
+        else {
+            sent[tag - REQ_TAG]++;
+            transmit(dest, {tag, rank, ts, rank, 0, 0}, nullptr, 0);
+        }
+    }
+
+    void flush_local() {
+        while (!local.empty()) {
+            pair<int,int> m = local.front();
+            local.pop_front();
+            handle(rank, m.first, m.second);
+        }
+    }
+
+    int slot(int member) const { return lower_bound(mySet.begin(), mySet.end(), member) - mySet.begin(); }
+
+    void vote(int pid, int ts) {
+        HaveVoted = true;
+        Candidate = pid;
+        Candidate_Ts = ts;
+        HaveInquired = false;
+        RLOG(LOG_DEBUG, EV_SEND, " -> Granted YES to {peer}", pid, YES_TAG, Ts);
+        post(pid, YES_TAG, ts);
+    }
+
+    void handle(int src, int tag, int ts) {
+        if (tag == REQ_TAG) {
+            Ts = max(Ts, ts) + 1;
+            RLOG(LOG_DEBUG, EV_RECV, "Received REQUEST from rank {peer} (ts={a})", src, REQ_TAG, Ts, ts);
+            if (!HaveVoted) vote(src, ts);
+            else {
+                WaitingQ.push({ts, src});
+                RLOG(LOG_DEBUG, EV_STATE, " -> Deferred request from {peer} (candidate={a}, c_ts={b})", src, REQ_TAG, Ts, Candidate, Candidate_Ts);
+                bool higher_priority = (ts < Candidate_Ts) || (ts == Candidate_Ts && src < Candidate);
+                if (higher_priority && !HaveInquired) {
+                    RLOG(LOG_DEBUG, EV_SEND, " -> New request has higher priority. Sending INQUIRE to current Candidate {peer}", Candidate, INQUIRE_TAG, Ts);
+                    post(Candidate, INQUIRE_TAG, Candidate_Ts);
+                    HaveInquired = true;
+                }
+            }
+        }
+        else if (tag == YES_TAG) {
+            Ts++;
+            int k = slot(src);
+            if (WantCS && ts == Request_Ts && !granted[k]) {
+                granted[k] = 1;
+                Yes_votes++;
+                RLOG(LOG_DEBUG, EV_RECV, "Received YES from rank {peer} -> Yes_votes={a}", src, YES_TAG, Ts, Yes_votes);
+            }
+            else RLOG(LOG_DEBUG, EV_RECV, "Received a stray YES from {peer}, ignoring.", src, YES_TAG, Ts);
+        }
+        else if (tag == INQUIRE_TAG) {
+            Ts++;
+            int k = slot(src);
+            if (WantCS && !inCS && ts == Request_Ts && granted[k]) {
+                RLOG(LOG_DEBUG, EV_SEND, " -> Still waiting for CS. Sending RELINQUISH to {peer}", src, RELINQ_TAG, Ts);
+                granted[k] = 0;
+                Yes_votes--;
+                post(src, RELINQ_TAG, ts);
+            }
+            else RLOG(LOG_DEBUG, EV_STATE, " -> Not relinquishing (inCS={a}, WantCS={b})", src, INQUIRE_TAG, Ts, inCS, WantCS);
+        }
+        else if (tag == RELINQ_TAG) {
+            Ts++;
+            RLOG(LOG_DEBUG, EV_RECV, "Received RELINQUISH from {peer}", src, RELINQ_TAG, Ts);
+            if (src != Candidate)
+                RLOG(LOG_WARN, EV_STATE, " -> WARNING: Received RELINQUISH from {peer} but my candidate was {a}", src, RELINQ_TAG, Ts, Candidate);
+            WaitingQ.push({Candidate_Ts, Candidate});
+            pair<int,int> next = WaitingQ.top();
+            WaitingQ.pop();
+            vote(next.second, next.first);
+        }
+        else if (tag == RELEASE_TAG) {
+            Ts++;
+            RLOG(LOG_DEBUG, EV_RECV, "Received RELEASE from {peer}", src, RELEASE_TAG, Ts);
+            if (src != Candidate)
+                RLOG(LOG_WARN, EV_STATE, " -> WARNING: Received RELEASE from {peer} but my candidate was {a}", src, RELEASE_TAG, Ts, Candidate);
+            HaveVoted = false;
+            Candidate = -1;
+            Candidate_Ts = 0;
+            HaveInquired = false;
+            if (!WaitingQ.empty()) {
+                pair<int,int> next = WaitingQ.top();
+                WaitingQ.pop();
+                vote(next.second, next.first);
+            }
+            else RLOG(LOG_DEBUG, EV_STATE, " -> No waiting requests after RELEASE; vote freed", -1, -1, Ts);
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Token engines: whoever holds the single token may enter, so a holder that
+// asks again while nobody else is waiting re-enters without any messages.
+//
+// Suzuki-Kasami: a process without the token broadcasts REQUEST(rank, n) with
+// its n-th request number (N - 1 messages). Everyone records the highest n
+// seen per process in RN. The token carries LN, the request number last
+// served per process, and the queue Q of waiting processes. On release, the
+// holder appends every j with RN[j] == LN[j] + 1 to Q and passes the token to
+// Q's head, as one message of N + |Q| ints. An idle holder passes it at once.
+//
+// Raymond: the processes form the heap-ordered binary tree, and every process
+// points `holder` at the neighbour in the token's direction. Requests queue
+// locally and one REQUEST per subtree travels up towards the token. The token
+// travels back down the same path, so an entry costs about 2 log2 N messages.
+
+const char* TOKEN_KIND_NAMES[2] = {"REQUEST", "TOKEN"};
+
+struct SuzukiKasamiNode : DmeEngine {
+    int rank, size;
+    vector<int> RN;                 // highest request number seen per process
+    bool HaveToken;
+    vector<int32_t> LN;             // token: request number last served per process
+    deque<int> Q;                   // token: processes waiting for it
+    bool WantCS = false, inCS = false;
+    vector<int32_t> token_buffer;
+
+    SuzukiKasamiNode(int r, int n) : rank(r), size(n), RN(n, 0), HaveToken(r == 0), LN(n, 0) {}
+
+    const char* name() const override { return "Suzuki-Kasami"; }
+    int num_kinds() const override { return 2; }
+    const char* kind_name(int k) const override { return TOKEN_KIND_NAMES[k]; }
+
+    bool ready() const override { return WantCS && HaveToken && !inCS; }
+
+    void request() override {
+        WantCS = true;
+        if (HaveToken) {
+            free_entries++;
+            RLOG(LOG_DEBUG, EV_STATE, "Holding the idle token, entering without messages");
+            return;
+        }
+        RN[rank]++;
+        RLOG(LOG_DEBUG, EV_SEND, "Broadcasting REQUEST n={a}", -1, REQ_TAG, 0, RN[rank]);
+        for (int j = 0; j < size; ++j) {
+            if (j == rank) continue;
+            sent[0]++;
+            transmit(j, {REQ_TAG, rank, RN[rank], 0, 0, 0}, nullptr, 0);
+        }
+    }
+
+    void enter() override { inCS = true; }
+
+    void release() override {
+        inCS = false;
+        WantCS = false;
+        LN[rank] = RN[rank];
+        vector<char> queued(size, 0);
+        for (int j : Q) queued[j] = 1;
+        for (int j = 0; j < size; ++j)
+            if (j != rank && !queued[j] && RN[j] == LN[j] + 1) Q.push_back(j);
+        pass_token();
+    }
+
+    void on_message(const WireMsg& m, const int32_t* payload) override {
+        if (m.tag == REQ_TAG) {
+            int j = m.sender;
+            RN[j] = max(RN[j], m.ts);
+            RLOG(LOG_DEBUG, EV_RECV, "Received REQUEST from {peer} n={a}", j, REQ_TAG, 0, m.ts);
+            if (HaveToken && !WantCS && RN[j] == LN[j] + 1) {
+                Q.push_back(j);
+                pass_token();
+            }
+        }
+        else if (m.tag == TOKEN_TAG) {
+            LN.assign(payload, payload + size);
+            Q.assign(payload + size, payload + m.length);
+            HaveToken = true;
+            RLOG(LOG_DEBUG, EV_RECV, "Received TOKEN from {peer}, {a} still queued", m.sender, TOKEN_TAG, 0, Q.size());
+        }
+    }
+
+private:
+    void pass_token() {
+        if (Q.empty()) return;
+        int next = Q.front();
+        Q.pop_front();
+        token_buffer.assign(LN.begin(), LN.end());
+        token_buffer.insert(token_buffer.end(), Q.begin(), Q.end());
+        HaveToken = false;
+        Q.clear();
+        RLOG(LOG_DEBUG, EV_SEND, "Passing TOKEN to {peer}", next, TOKEN_TAG);
+        sent[1]++;
+        transmit(next, {TOKEN_TAG, rank, 0, 0, 0, 0}, token_buffer.data(), token_buffer.size());
+    }
+};
+
+struct RaymondNode : DmeEngine {
+    int rank;
+    int holder;                     // self, or the tree neighbour towards the token
+    deque<int> request_q;           // self and neighbours that asked through this process
+    bool asked = false;             // a REQUEST towards holder is outstanding
+    bool privileged = false;        // holds the token for its own entry
+    bool WantCS = false, inCS = false;
+
+    RaymondNode(int r) : rank(r), holder(r == 0 ? 0 : (r - 1) / 2) {}
+
+    const char* name() const override { return "Raymond"; }
+    int num_kinds() const override { return 2; }
+    const char* kind_name(int k) const override { return TOKEN_KIND_NAMES[k]; }
+
+    bool ready() const override { return WantCS && privileged && !inCS; }
+
+    void request() override {
+        WantCS = true;
+        request_q.push_back(rank);
+        assign_privilege();
+        make_request();
+        if (privileged) free_entries++;
+    }
+
+    void enter() override { inCS = true; }
+
+    void release() override {
+        inCS = false;
+        WantCS = false;
+        privileged = false;
+        assign_privilege();
+        make_request();
+    }
+
+    void on_message(const WireMsg& m, const int32_t*) override {
+        if (m.tag == REQ_TAG) {
+            RLOG(LOG_DEBUG, EV_RECV, "Received REQUEST from {peer}", m.sender, REQ_TAG);
+            request_q.push_back(m.sender);
+        }
+        else if (m.tag == TOKEN_TAG) {
+            RLOG(LOG_DEBUG, EV_RECV, "Received TOKEN from {peer}", m.sender, TOKEN_TAG);
+            holder = rank;
+        }
+        assign_privilege();
+        make_request();
+    }
+
+private:
+    void assign_privilege() {
+        if (holder != rank || privileged || request_q.empty()) return;
+        holder = request_q.front();
+        request_q.pop_front();
+        asked = false;
+        if (holder == rank) privileged = true;
+        else {
+            RLOG(LOG_DEBUG, EV_SEND, "Passing TOKEN to {peer}", holder, TOKEN_TAG);
+            sent[1]++;
+            transmit(holder, {TOKEN_TAG, rank, 0, 0, 0, 0}, nullptr, 0);
+        }
+    }
+
+    void make_request() {
+        if (holder == rank || request_q.empty() || asked) return;
+        asked = true;
+        RLOG(LOG_DEBUG, EV_SEND, "Sending REQUEST towards the token via {peer}", holder, REQ_TAG);
+        sent[0]++;
+        transmit(holder, {REQ_TAG, rank, 0, 0, 0, 0}, nullptr, 0);
+    }
+};
+
+// one engine for `rank`; quorum kinds use quorums[rank]
+unique_ptr<DmeEngine> make_engine(const string& kind, int rank, int size, const vector<vector<int>>& quorums) {
+    if (kind == "sk") return unique_ptr<DmeEngine>(new SuzukiKasamiNode(rank, size));
+    if (kind == "raymond") return unique_ptr<DmeEngine>(new RaymondNode(rank));
+    return unique_ptr<DmeEngine>(new MaekawaNode(rank, quorums[rank]));
+}
+
+bool is_token_engine(const string& kind) { return kind == "sk" || kind == "raymond"; }
+
+// ---------------------------------------------------------------------------
+// In-process simulation of N engines with a fixed message delay of one time
+// unit T and per-channel FIFO order, so engines and quorum constructions can
+// be compared at N far beyond the ranks available. Under "light" load one
+// process requests at a time; under "heavy" load all N request within the
+// first 2T.
+
+struct SimResult {
+    long long entries = 0, messages = 0;
+    double sync_delay = 0;        // mean exit -> next entry while requests wait, in T
+    double wait = 0;              // mean request -> entry, in T
+    bool exclusive = true, completed = true;
+};
+
+SimResult simulate(const string& kind, int n, const vector<vector<int>>& quorums, bool heavy, double cs_time) {
+    struct Event {
+        double time;
+        long long seq;
+        int kind, dest;                  // kind 0 message, 1 request, 2 exit
+        WireMsg msg;
+        vector<int32_t> payload;
+        bool operator>(const Event& o) const { return time != o.time ? time > o.time : seq > o.seq; }
     };
+    priority_queue<Event, vector<Event>, greater<Event>> events;
+    long long seq = 0;
+    double now = 0;
+
+    vector<unique_ptr<DmeEngine>> nodes;
+    for (int i = 0; i < n; ++i) {
+        nodes.push_back(make_engine(kind, i, n, quorums));
+        nodes[i]->transmit = [&](int dest, const WireMsg& m, const int32_t* payload, int length) {
+            events.push({now + 1, seq++, 0, dest, m, vector<int32_t>(payload, payload + length)});
+        };
+    }
+    // heavy requests are spread over [0, 2T) so voters see them in mixed order
+    const double gap = cs_time + 10;
+    for (int i = 0; i < n; ++i) {
+        double jitter = (uint32_t)(i * 2654435761u) / 4294967296.0 * 2;
+        events.push({heavy ? jitter : i * gap, seq++, 1, i, WireMsg(), {}});
+    }
+
+    SimResult r;
+    vector<double> requested(n, 0);
+    int in_cs = 0;
+    double last_exit = -1, delay_sum = 0, wait_sum = 0;
+    long long delays = 0;
+    while (!events.empty()) {
+        Event e = events.top();
+        events.pop();
+        now = e.time;
+        DmeEngine& node = *nodes[e.dest];
+        if (e.kind == 0) {
+            e.msg.length = e.payload.size();
+            node.on_message(e.msg, e.payload.data());
+        }
+        else if (e.kind == 1) {
+            requested[e.dest] = now;
+            node.request();
+        }
+        else {
+            in_cs--;
+            last_exit = now;
+            node.release();
+        }
+        if (node.ready()) {
+            node.enter();
+            r.exclusive &= ++in_cs == 1;
+            r.entries++;
+            wait_sum += now - requested[e.dest];
+            if (last_exit >= 0 && requested[e.dest] <= last_exit) {
+                delay_sum += now - last_exit;
+                delays++;
+            }
+            events.push({now + cs_time, seq++, 2, e.dest, WireMsg(), {}});
+        }
+    }
+    for (const unique_ptr<DmeEngine>& node : nodes)
+        for (int k = 0; k < node->num_kinds(); ++k) r.messages += node->sent[k];
+    r.completed = r.entries == n;
+    r.sync_delay = delays ? delay_sum / delays : 0;
+    r.wait = r.entries ? wait_sum / r.entries : 0;
+    return r;
+}
+
+void run_quorum_benchmark(int max_n) {
+    const double CS_TIME = 1;
+    vector<int> sizes = {7, 13, 31, 64, 133, 256, 381, 553, 993, 1024};
+    cout << "Maekawa quorums and token engines, simulated with message delay T = 1 and CS time " << CS_TIME << " T" << endl;
+    cout << setw(6) << "N" << setw(9) << "engine" << setw(8) << "K avg" << setw(6) << "K max" << setw(6) << "load"
+         << setw(7) << "check" << setw(12) << "msgs light" << setw(12) << "msgs heavy" << setw(12) << "sync delay"
+         << setw(10) << "wait" << setw(7) << "mutex" << "   (msgs per CS entry; sync delay and wait in T)" << endl;
+    for (int n : sizes) {
+        if (n > max_n) break;
+        for (const char* kind : {"grid", "fpp", "tree", "sk", "raymond"}) {
+            vector<vector<int>> quorums = build_quorums(kind, n);
+            SimResult light = simulate(kind, n, quorums, false, CS_TIME);
+            SimResult heavy = simulate(kind, n, quorums, true, CS_TIME);
+            bool ok = light.exclusive && light.completed && heavy.exclusive && heavy.completed;
+            cout << fixed << setprecision(1) << setw(6) << n << setw(9) << kind;
+            if (is_token_engine(kind)) cout << setw(8) << "-" << setw(6) << "-" << setw(6) << "-" << setw(7) << "-";
+            else {
+                QuorumReport q = check_quorums(quorums);
+                cout << setw(8) << q.avg_size << setw(6) << q.max_size << setw(6) << q.max_load
+                     << setw(7) << (q.intersecting && q.self_member ? "ok" : "FAIL");
+            }
+            cout << setw(12) << (double)light.messages / max(1LL, light.entries)
+                 << setw(12) << (double)heavy.messages / max(1LL, heavy.entries)
+                 << setw(12) << heavy.sync_delay << setw(10) << heavy.wait << setw(7) << (ok ? "ok" : "FAIL") << endl;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// The MPI run: one engine per rank under a CS workload. A requesting rank
+// thinks for an exponentially distributed time, requests the CS, holds it
+// for cs_ms and releases it, over and over until `seconds` have passed or it
+// has made max_entries entries. A rank with nothing left to request joins an
+// MPI_Ibarrier and keeps serving the protocol; once every rank has joined,
+// the ranks drain the messages still in flight (global quiescence) and rank
+// 0 reports.
+
+struct CsWorkload {
+    double seconds = 5;       // stop issuing requests after this long
+    double think_ms = 5;      // mean think time between a release and the next request
+    double cs_ms = 0.5;       // time held inside the CS
+    double first_ms = 0;      // delay before the first request
+    int max_entries = -1;     // per rank, -1 = until `seconds`
+    bool verbose = false;     // print ENTER/LEAVE lines
+};
+
+// CLOCK_MONOTONIC is shared by the ranks of one node (MPI_Wtime's origin is per
+// process in Open MPI), so entry intervals from different ranks can be compared
+double now_seconds() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Global quiescence, entered by every rank once none will start new protocol
+// work: each rank learns how many messages were addressed to it and drains
+// until they have all arrived. Handling them may send more, so the rounds
+// repeat until the global send count stops changing.
+template <class Drain>
+void wait_quiescent(WireChannel& channel, Drain drain) {
+    long long total_sent = -1, now_sent = 0;
+    while (true) {
+        int expected = 0;
+        MPI_Reduce_scatter_block(channel.sent_to().data(), &expected, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        while (channel.received() < expected) {
+            if (!drain()) std::this_thread::yield();
+        }
+        long long mine = 0;
+        for (int c : channel.sent_to()) mine += c;
+        MPI_Allreduce(&mine, &now_sent, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        if (now_sent == total_sent) break;
+        total_sent = now_sent;
+    }
+}
+
+int run_dme(int rank, int size, const string& kind, bool requester, const CsWorkload& w) {
+    const vector<vector<int>> S = build_quorums(kind, size);
+    if (S.empty() && !is_token_engine(kind)) {
+        if (rank == 0) cerr << "unknown engine '" << kind << "' (grid, fpp, tree, sk or raymond)\n";
+        return 1;
+    }
+    if (is_token_engine(kind)) {
+        if (rank == 0) cout << "=== Starting " << (kind == "sk" ? "Suzuki-Kasami" : "Raymond") << " DME simulation (N = " << size << ") ===\n";
+    }
+    else {
+        QuorumReport q = check_quorums(S);
+        if (rank == 0) {
+            cout << "=== Starting Maekawa DME simulation (" << kind << " quorums, N = " << size << ") ===\n";
+            cout << "quorum size min/avg/max " << q.min_size << "/" << fixed << setprecision(1) << q.avg_size << defaultfloat
+                 << "/" << q.max_size << ", max load " << q.max_load << ", pairwise intersection "
+                 << (q.intersecting && q.self_member ? "ok" : "FAILED") << "\n";
+            if (size <= PRINT_LIMIT) {
+                for (int i = 0; i < size; ++i) {
+                    cout << "  S[" << i << "] = {";
+                    for (size_t k = 0; k < S[i].size(); ++k) cout << (k ? "," : "") << S[i][k];
+                    cout << "}\n";
+                }
+            }
+        }
+        if (!q.intersecting || !q.self_member) return 1;
+    }
+
+    WireChannel channel(MPI_COMM_WORLD);
+    unique_ptr<DmeEngine> engine = make_engine(kind, rank, size, S);
+    DmeEngine& node = *engine;
+    node.transmit = [&](int dest, const WireMsg& m, const int32_t* payload, int length) { channel.send(dest, m, payload, length); };
 
     auto log = [&](const string &msg){
          cout << "[Rank " << rank << "] " << msg << endl;
     };
-    
-    auto log_nb = [&](const string &msg){
-         cout << "[Rank " << rank << "] " << msg << endl;
+
+    // protocol trace goes to the async per-rank log (maekawa.rank<N>.log)
+    RankLog event_log("maekawa", rank);
+
+    auto drain = [&]() {
+        return channel.poll([&](const WireMsg& m, const int32_t* payload) { node.on_message(m, payload); });
     };
 
+    mt19937_64 rng(20251017 + rank);
+    exponential_distribution<double> think(w.think_ms > 0 ? 1e3 / w.think_ms : 1.0);
+    vector<double> records;                 // (request, enter, exit) per CS entry
+    int entries = 0;
+    bool waiting = false, stopped = !requester, joined = false;
+    double t_request = 0;
 
     MPI_Barrier(MPI_COMM_WORLD);
-    if (rank == 0) cout << "=== Starting Maekawa DME simulation (Corrected) ===\n";
+    const double t_start = now_seconds();
+    double next_request = t_start + w.first_ms * 1e-3;
+    MPI_Request barrier = MPI_REQUEST_NULL;
+    int everyone_done = 0;
+    while (!everyone_done) {
+        bool busy = drain();
+        double now = now_seconds();
+        if (!stopped && (now - t_start >= w.seconds || entries == w.max_entries)) stopped = true;
+        if (!stopped && !waiting && now >= next_request) {
+            t_request = now;
+            waiting = true;
+            node.request();
+            busy = true;
+        }
+        if (waiting && node.ready()) {
+            // === ENTER CS ===
+            node.enter();
+            double t_enter = now_seconds();
+            if (w.verbose) log("=== ENTERING CRITICAL SECTION ===");
+            std::this_thread::sleep_for(std::chrono::microseconds((long long)(w.cs_ms * 1e3)));
+            if (w.verbose) log("=== LEAVING CRITICAL SECTION ===");
+            double t_exit = now_seconds();
+            // === EXIT CS ===
+            node.release();
+            records.insert(records.end(), {t_request, t_enter, t_exit});
+            entries++;
+            waiting = false;
+            next_request = t_exit + (w.think_ms > 0 ? think(rng) : 0);
+            busy = true;
+        }
+        if (stopped && !waiting && !joined) {
+            MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+            joined = true;
+        }
+        if (joined) MPI_Test(&barrier, &everyone_done, MPI_STATUS_IGNORE);
+        if (!busy) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100 * (rank % 2))); 
+    wait_quiescent(channel, drain);
 
-    bool initiator = (rank == 1) || (rank == 5);
+    // entry intervals and message counts to rank 0
+    int n_values = records.size();
+    vector<int> counts(size), displs(size);
+    MPI_Gather(&n_values, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    vector<double> all_records;
+    if (rank == 0) {
+        int sum = 0;
+        for (int r = 0; r < size; ++r) { displs[r] = sum; sum += counts[r]; }
+        all_records.resize(sum);
+    }
+    MPI_Gatherv(records.data(), n_values, MPI_DOUBLE, all_records.data(), counts.data(), displs.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    double first_start = 0;
+    MPI_Reduce(&t_start, &first_start, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    // per-kind message counts, then MPI calls and message-free entries
+    long long kinds[NUM_KINDS + 2], total_kinds[NUM_KINDS + 2];
+    for (int k = 0; k < NUM_KINDS; ++k) kinds[k] = node.sent[k];
+    kinds[NUM_KINDS] = channel.calls();
+    kinds[NUM_KINDS + 1] = node.free_entries;
+    MPI_Reduce(kinds, total_kinds, NUM_KINDS + 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    if (initiator) {
-        WantCS = true;
-        Ts++;                         
-        Yes_votes = 1;                
+    if (rank == 0) {
+        // sorted by entry time: (enter, exit, request)
+        vector<array<double, 3>> cs;
+        for (size_t k = 0; k + 2 < all_records.size(); k += 3)
+            cs.push_back({all_records[k + 1], all_records[k + 2], all_records[k]});
+        sort(cs.begin(), cs.end());
+        bool exclusive = true;
+        double delay_sum = 0, last_exit = first_start;
+        long long delays = 0;
+        vector<float> latency_ms;
+        for (size_t k = 0; k < cs.size(); ++k) {
+            latency_ms.push_back((cs[k][0] - cs[k][2]) * 1e3);
+            last_exit = max(last_exit, cs[k][1]);
+            if (k == 0) continue;
+            exclusive &= cs[k][0] >= cs[k - 1][1];
+            if (cs[k][2] < cs[k - 1][1]) {
+                delay_sum += cs[k][0] - cs[k - 1][1];
+                delays++;
+            }
+        }
+        sort(latency_ms.begin(), latency_ms.end());
+        long long messages = 0;
+        for (int k = 0; k < NUM_KINDS; ++k) messages += total_kinds[k];
+        long long n_entries = cs.size();
+        double window = last_exit - first_start;
+        cout << "CS entries: " << n_entries << ", mutual exclusion " << (exclusive ? "held" : "VIOLATED") << "\n";
+        cout << fixed << setprecision(1) << "throughput: " << (window > 0 ? n_entries / window : 0) << " entries/sec over "
+             << setprecision(3) << window << " s\n";
+        cout << "messages: " << messages;
+        for (int k = 0; k < node.num_kinds(); ++k) cout << (k ? ", " : " (") << node.kind_name(k) << " " << total_kinds[k];
+        cout << "), " << setprecision(1) << (double)messages / max(1LL, n_entries) << " per CS entry\n";
+        if (is_token_engine(kind))
+            cout << "token-holder re-entries: " << total_kinds[NUM_KINDS + 1] << " of " << n_entries << " (0 messages each)\n";
+        cout << "MPI calls (send, probe, receive): " << total_kinds[NUM_KINDS] << ", "
+             << (double)total_kinds[NUM_KINDS] / max(1LL, n_entries) << " per CS entry\n";
+        cout << setprecision(3) << "request -> entry ms: p50 " << percentile(latency_ms, 0.50) << ", p99 "
+             << percentile(latency_ms, 0.99) << ", p999 " << percentile(latency_ms, 0.999) << ", max "
+             << (latency_ms.empty() ? 0 : latency_ms.back()) << "\n";
+        cout << "sync delay: " << (delays ? delay_sum / delays * 1e3 : 0) << " ms avg over " << delays << " handovers\n" << defaultfloat;
+        cout << "=== Simulation finished (" << node.name() << ") ===\n";
+    }
+    return 0;
+}
 
-        HaveVoted = true;
-        Candidate = rank;
-        Candidate_Ts = Ts;
+// ---------------------------------------------------------------------------
+// Lock manager: Maekawa over many named locks at once. Every lock uses the
+// same quorums, but each voter keeps HaveVoted/Candidate/Candidate_Ts/
+// HaveInquired/WaitingQ per lock, so requests for different locks never wait
+// on each other's votes. Only locks with live state occupy the voter table,
+// so its size follows the locks in use, not the lock space.
+//
+// Protocol traffic is a stream of (kind, lock, ts) records. Records for the
+// same process are buffered and leave as one DLM_TAG message per destination
+// per tick, so REQUESTs, RELEASEs and votes for different locks share a send.
+
+// open-addressing map from lock id to per-lock state: linear probing over a
+// power-of-two array, with backward-shift deletion, so a lock that goes idle
+// gives its slot back without leaving a tombstone
+template <class State>
+class LockTable {
+public:
+    LockTable() : slots_(16) {}
 
-        log_nb("Wants CS. Broadcasting REQUEST to voting set (ts=" + to_string(Ts) + ")");
+    State* find(int32_t id) {
+        for (size_t i = home(id);; i = next(i)) {
+            if (slots_[i].id == id) return &slots_[i].state;
+            if (slots_[i].id == EMPTY) return nullptr;
+        }
+    }
 
-        // send REQ(ts, pid) 
-        for (int member : mySet) {
-            if (member == rank) continue; 
-            sendInt(member, REQ_TAG, Ts);
-            sendInt(member, REQ_TAG, rank);
+    // inserts a default State if id is absent; may move every entry
+    State& get(int32_t id) {
+        if (2 * (used_ + 1) > slots_.size()) grow();
+        size_t i = home(id);
+        while (slots_[i].id != EMPTY && slots_[i].id != id) i = next(i);
+        if (slots_[i].id == EMPTY) {
+            slots_[i].id = id;
+            used_++;
+            peak_ = max(peak_, used_);
         }
+        return slots_[i].state;
     }
 
-    bool done = false;
+    void erase(int32_t id) {
+        size_t hole = home(id);
+        while (slots_[hole].id != id) {
+            if (slots_[hole].id == EMPTY) return;
+            hole = next(hole);
+        }
+        // pull later entries of the probe run back, unless that would move one before its home slot
+        for (size_t j = next(hole); slots_[j].id != EMPTY; j = next(j)) {
+            size_t mask = slots_.size() - 1;
+            if (((j - home(slots_[j].id)) & mask) >= ((j - hole) & mask)) {
+                slots_[hole] = std::move(slots_[j]);
+                hole = j;
+            }
+        }
+        slots_[hole] = Slot();
+        used_--;
+    }
+
+    size_t size() const { return used_; }
+    size_t peak() const { return peak_; }
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    static const int32_t EMPTY = -1;
+    struct Slot {
+        int32_t id = EMPTY;
+        State state;
+    };
+
+    // Fibonacci hashing: consecutive lock ids spread over the whole table
+    size_t home(int32_t id) const { return ((uint32_t)id * 2654435769u) >> (32 - bits_); }
+    size_t next(size_t i) const { return (i + 1) & (slots_.size() - 1); }
+
+    void grow() {
+        vector<Slot> old(slots_.size() * 2);
+        old.swap(slots_);
+        bits_++;
+        used_ = 0;
+        for (Slot& s : old)
+            if (s.id != EMPTY) get(s.id) = std::move(s.state);
+    }
+
+    vector<Slot> slots_;
+    int bits_ = 4;
+    size_t used_ = 0, peak_ = 0;
+};
+
+#define DLM_TAG       16
+const int DLM_RECORD_INTS = 3;           // (kind tag, lock, ts)
+
+// per-lock voter state, as in MaekawaNode
+struct LockVoter {
+    bool HaveVoted = false;
+    int Candidate = -1;
+    int Candidate_Ts = 0;
+    bool HaveInquired = false;
+    priority_queue<pair<int,int>, vector<pair<int,int>>, greater<pair<int,int>>> WaitingQ;
+};
+
+// one outstanding acquisition; a process runs several, each on a different lock
+struct LockClient {
+    int lock = -1;
+    int Request_Ts = 0;
+    int Yes_votes = 0;
+    bool WantCS = false;
     bool inCS = false;
-    int expectedYes = (int)mySet.size();
-
-    auto start = chrono::steady_clock::now();
-    const int TIMEOUT_MS = 15000;
-
-    while (!done) {
-        MPI_Status status;
-        int flag = 0;
-        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
-        
-        if (flag) {
-            int src = status.MPI_SOURCE;
-            int tag = status.MPI_TAG;
-
-            if (tag == REQ_TAG) {
-                int recv_ts, recv_pid;
-                MPI_Recv(&recv_ts, 1, MPI_INT, src, REQ_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(&recv_pid, 1, MPI_INT, src, REQ_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-                Ts = max(Ts, recv_ts) + 1;
-                log_nb("Received REQUEST from rank " + to_string(recv_pid) + " (ts=" + to_string(recv_ts) + ")");
-
-                if (!HaveVoted) {
-                    HaveVoted = true;
-                    Candidate = recv_pid;
-                    Candidate_Ts = recv_ts;
-                    HaveInquired = false; 
-                    log_nb(" -> Granted YES to " + to_string(recv_pid));
-                    sendInt(recv_pid, YES_TAG, rank);
-                } 
-                else {
-                    WaitingQ.push({recv_ts, recv_pid});
-                    log_nb(" -> Deferred request from " + to_string(recv_pid) + " (candidate=" + to_string(Candidate) + ", c_ts=" + to_string(Candidate_Ts) + ")");
-                    
-                    bool higher_priority = (recv_ts < Candidate_Ts) || (recv_ts == Candidate_Ts && recv_pid < Candidate);
-                    if (higher_priority && !HaveInquired) {
-                        log_nb(" -> New request has higher priority. Sending INQUIRE to current Candidate " + to_string(Candidate));
-                        sendInt(Candidate, INQUIRE_TAG, rank);
-                        HaveInquired = true;
-                    }
+    vector<char> granted;                                // parallel to mySet
+};
+
+struct LockManager {
+    function<void(int dest, const WireMsg& m, const int32_t* payload, int length)> transmit;
+    long long records[NUM_KINDS] = {};  // records to other processes, by kind
+    long long batches = 0;              // DLM_TAG messages carrying them
+
+    int rank = 0;
+    int Ts = 0;
+    vector<int> mySet;                                   // sorted, contains rank
+    vector<LockClient> clients;
+    LockTable<int> pending;                              // lock -> client requesting it
+    LockTable<LockVoter> voters;
+
+    LockManager(int r, const vector<int>& quorum, int n_clients, int size)
+        : rank(r), mySet(quorum), clients(n_clients), outbox(size) {
+        for (LockClient& c : clients) c.granted.assign(quorum.size(), 0);
+    }
+
+    // false if this process already has a request out for `lock`
+    bool acquire(int c, int lock) {
+        if (pending.find(lock)) return false;
+        pending.get(lock) = c;
+        LockClient& cl = clients[c];
+        Ts++;
+        cl.lock = lock;
+        cl.Request_Ts = Ts;
+        cl.Yes_votes = 0;
+        cl.WantCS = true;
+        fill(cl.granted.begin(), cl.granted.end(), 0);
+        for (int member : mySet) post(member, REQ_TAG, lock, cl.Request_Ts);
+        flush_local();
+        return true;
+    }
+
+    bool ready(int c) const {
+        const LockClient& cl = clients[c];
+        return cl.WantCS && !cl.inCS && cl.Yes_votes == (int)mySet.size();
+    }
+
+    void enter(int c) { clients[c].inCS = true; }
+
+    void release(int c) {
+        LockClient& cl = clients[c];
+        cl.WantCS = false;
+        cl.inCS = false;
+        pending.erase(cl.lock);
+        for (int member : mySet) post(member, RELEASE_TAG, cl.lock, cl.Request_Ts);
+        flush_local();
+    }
+
+    void on_message(const WireMsg& m, const int32_t* payload) {
+        for (int k = 0; k < m.length; k += DLM_RECORD_INTS) handle(m.sender, payload[k], payload[k + 1], payload[k + 2]);
+        flush_local();
+    }
+
+    // one message per destination with everything queued for it since the last flush
+    void flush() {
+        for (int dest : dirty) {
+            vector<int32_t>& out = outbox[dest];
+            transmit(dest, {DLM_TAG, rank, Ts, 0, 0, 0}, out.data(), (int)out.size());
+            batches++;
+            out.clear();
+        }
+        dirty.clear();
+    }
+
+private:
+    vector<vector<int32_t>> outbox;                      // records per destination
+    vector<int> dirty;                                   // destinations with a non-empty outbox
+    deque<array<int,3>> local;                           // records sent to self
+
+    void post(int dest, int tag, int lock, int ts) {
+        if (dest == rank) { local.push_back({tag, lock, ts}); return; }
+        records[tag - REQ_TAG]++;
+        vector<int32_t>& out = outbox[dest];
+        if (out.empty()) dirty.push_back(dest);
+        out.insert(out.end(), {tag, lock, ts});
+    }
+
+    void flush_local() {
+        while (!local.empty()) {
+            array<int,3> m = local.front();
+            local.pop_front();
+            handle(rank, m[0], m[1], m[2]);
+        }
+    }
+
+    int slot(int member) const { return lower_bound(mySet.begin(), mySet.end(), member) - mySet.begin(); }
+
+    // the client whose current request on `lock` has timestamp ts, if any
+    LockClient* request_for(int lock, int ts) {
+        int* c = pending.find(lock);
+        if (!c || clients[*c].Request_Ts != ts) return nullptr;
+        return &clients[*c];
+    }
+
+    void vote(LockVoter& v, int lock, int pid, int ts) {
+        v.HaveVoted = true;
+        v.Candidate = pid;
+        v.Candidate_Ts = ts;
+        v.HaveInquired = false;
+        post(pid, YES_TAG, lock, ts);
+    }
+
+    void handle(int src, int tag, int lock, int ts) {
+        if (tag == REQ_TAG) {
+            Ts = max(Ts, ts) + 1;
+            LockVoter& v = voters.get(lock);
+            if (!v.HaveVoted) vote(v, lock, src, ts);
+            else {
+                v.WaitingQ.push({ts, src});
+                bool higher_priority = (ts < v.Candidate_Ts) || (ts == v.Candidate_Ts && src < v.Candidate);
+                if (higher_priority && !v.HaveInquired) {
+                    post(v.Candidate, INQUIRE_TAG, lock, v.Candidate_Ts);
+                    v.HaveInquired = true;
                 }
             }
-            else if (tag == YES_TAG) {
-                int sender_rank;
-                MPI_Recv(&sender_rank, 1, MPI_INT, src, YES_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                Ts = Ts + 1;
-                if(WantCS) { 
-                    Yes_votes++;
-                    log_nb("Received YES from rank " + to_string(sender_rank) + " -> Yes_votes=" + to_string(Yes_votes));
-                } 
-                else {
-                    log_nb("Received a stray YES from " + to_string(sender_rank) + ", ignoring.");
-                }
+            return;
+        }
+        Ts++;
+        if (tag == YES_TAG) {
+            LockClient* cl = request_for(lock, ts);
+            int k = slot(src);
+            if (cl && cl->WantCS && !cl->granted[k]) {
+                cl->granted[k] = 1;
+                cl->Yes_votes++;
             }
-            else if (tag == INQUIRE_TAG) {
-                int inquirer;
-                MPI_Recv(&inquirer, 1, MPI_INT, src, INQUIRE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                Ts = Ts + 1;
-                log_nb("Received INQUIRE from rank " + to_string(inquirer));
-
-                if (WantCS && !inCS) {
-                    // Send RELINQUISH to inquirer (the voter)
-                    log_nb(" -> Still waiting for CS. Sending RELINQUISH to " + to_string(inquirer));
-                    sendInt(inquirer, RELINQ_TAG, rank);
-                    Yes_votes = max(0, Yes_votes - 1);
-                } 
-                else {
-                    log_nb(" -> Not relinquishing (inCS=" + string(inCS ? "true":"false") + ", WantCS=" + string(WantCS ? "true":"false") + ")");
-                }
+        }
+        else if (tag == INQUIRE_TAG) {
+            LockClient* cl = request_for(lock, ts);
+            int k = slot(src);
+            if (cl && cl->WantCS && !cl->inCS && cl->granted[k]) {
+                cl->granted[k] = 0;
+                cl->Yes_votes--;
+                post(src, RELINQ_TAG, lock, ts);
             }
-            else if (tag == RELINQ_TAG) {
-                int rel_sender; 
-                MPI_Recv(&rel_sender, 1, MPI_INT, src, RELINQ_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                Ts = Ts + 1;
-                log_nb("Received RELINQUISH from " + to_string(rel_sender));
-
-                if (rel_sender != Candidate) {
-                     log_nb(" -> WARNING: Received RELINQUISH from " + to_string(rel_sender) + " but my candidate was " + to_string(Candidate));
-                }
-
-                WaitingQ.push({Candidate_Ts, Candidate});
-                auto next = WaitingQ.top();
-                WaitingQ.pop();
-                
-                if (next.first != -1) {
-                    int chosen_pid = next.second;
-                    Candidate = chosen_pid;
-                    Candidate_Ts = next.first;
-                    HaveInquired = false;
-                    HaveVoted = true;    
-                    
-                    log_nb(" -> Granting YES to " + to_string(chosen_pid) + " after RELINQUISH");
-                    sendInt(chosen_pid, YES_TAG, rank);
-                } else {
-                    HaveVoted = false;
-                    Candidate = -1;
-                    Candidate_Ts = 0;
-                    HaveInquired = false;
-                    log_nb(" -> No waiting requests; vote freed (UNEXPECTED after RELINQUISH)");
-                }
+        }
+        else if (tag == RELINQ_TAG) {
+            LockVoter* v = voters.find(lock);
+            if (!v || src != v->Candidate) {
+                RLOG(LOG_WARN, EV_STATE, " -> WARNING: RELINQUISH for lock {a} from {peer}, not its candidate", src, RELINQ_TAG, Ts, lock);
+                return;
             }
-            else if (tag == RELEASE_TAG) {
-                int rel_pid;
-                MPI_Recv(&rel_pid, 1, MPI_INT, src, RELEASE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                Ts = Ts + 1;
-                log_nb("Received RELEASE from " + to_string(rel_pid));
-
-                if (rel_pid != Candidate) {
-                    log_nb(" -> WARNING: Received RELEASE from " + to_string(rel_pid) + " but my candidate was " + to_string(Candidate));
-                }
+            v->WaitingQ.push({v->Candidate_Ts, v->Candidate});
+            pair<int,int> next = v->WaitingQ.top();
+            v->WaitingQ.pop();
+            vote(*v, lock, next.second, next.first);
+        }
+        else if (tag == RELEASE_TAG) {
+            LockVoter* v = voters.find(lock);
+            if (!v || src != v->Candidate) {
+                RLOG(LOG_WARN, EV_STATE, " -> WARNING: RELEASE for lock {a} from {peer}, not its candidate", src, RELEASE_TAG, Ts, lock);
+                return;
+            }
+            if (v->WaitingQ.empty()) {
+                voters.erase(lock);
+                return;
+            }
+            pair<int,int> next = v->WaitingQ.top();
+            v->WaitingQ.pop();
+            vote(*v, lock, next.second, next.first);
+        }
+    }
+};
 
-                HaveVoted = false;
-                Candidate = -1;
-                Candidate_Ts = 0;
-                HaveInquired = false;
-
-                if (!WaitingQ.empty()) {
-                    auto nxt = WaitingQ.top();
-                    WaitingQ.pop();
-                    int chosen = nxt.second;
-                    Candidate = chosen;
-                    Candidate_Ts = nxt.first;
-                    HaveVoted = true; 
-                    
-                    log_nb(" -> Granting YES to " + to_string(chosen) + " due to RELEASE");
-                    sendInt(chosen, YES_TAG, rank);
-                } 
-                else {
-                    log_nb(" -> No waiting requests after RELEASE; vote freed");
-                }
+struct DlmWorkload {
+    int max_locks = 4096;     // the sweep runs 1, 4, 16, ... locks up to this
+    double seconds = 2;       // per step
+    double think_ms = 1;      // mean think time between a release and the next acquisition
+    double cs_ms = 0.5;       // time a lock is held
+    int clients = 8;          // concurrent acquisitions per rank
+};
+
+// One step of the sweep: every rank runs w.clients clients, each picking a
+// uniformly random lock out of `locks` that this rank is not already after.
+// A held lock is a deadline, not a sleep, so a rank holds several at once.
+// Rank 0 prints the step's row of the table.
+void run_dlm_step(WireChannel& channel, int rank, int size, const vector<int>& quorum, int locks, const DlmWorkload& w) {
+    LockManager mgr(rank, quorum, w.clients, size);
+    mgr.transmit = [&](int dest, const WireMsg& m, const int32_t* payload, int length) { channel.send(dest, m, payload, length); };
+    auto drain = [&]() {
+        return channel.poll([&](const WireMsg& m, const int32_t* payload) { mgr.on_message(m, payload); });
+    };
+    const long long calls_before = channel.calls();
+
+    mt19937_64 rng(20251017 + 7919 * rank + locks);
+    exponential_distribution<double> think(w.think_ms > 0 ? 1e3 / w.think_ms : 1.0);
+    uniform_int_distribution<int> pick(0, locks - 1);
+    struct Timing { double next = 0, requested = 0, entered = 0; };
+    vector<Timing> timing(w.clients);
+    vector<double> records;                 // (lock, request, enter, exit) per acquisition
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    const double t_start = now_seconds();
+    for (Timing& t : timing) t.next = t_start + (w.think_ms > 0 ? think(rng) : 0);
+    bool joined = false;
+    MPI_Request barrier = MPI_REQUEST_NULL;
+    int everyone_done = 0;
+    while (!everyone_done) {
+        bool busy = drain();
+        double now = now_seconds();
+        bool stopped = now - t_start >= w.seconds;
+        int active = 0;
+        for (int c = 0; c < w.clients; ++c) {
+            LockClient& cl = mgr.clients[c];
+            Timing& t = timing[c];
+            if (cl.inCS && now >= t.entered + w.cs_ms * 1e-3) {
+                mgr.release(c);
+                records.insert(records.end(), {(double)cl.lock, t.requested, t.entered, now});
+                t.next = now + (w.think_ms > 0 ? think(rng) : 0);
+                busy = true;
             }
-            
-        } 
-
-        // Check if enter CS
-        if (initiator && WantCS && !inCS) {
-            if (Yes_votes >= expectedYes) {
-                // === ENTER CS ===
-                inCS = true;
-                log("=== ENTERING CRITICAL SECTION (ts=" + to_string(Ts) + ") ===");
-                std::this_thread::sleep_for(std::chrono::milliseconds(500 + 50 * rank));
-                log("=== LEAVING CRITICAL SECTION ===");
-                // === EXIT CS ===
-
-                // Sending RELEASE 
-                WantCS = false;
-                inCS = false;
-                Yes_votes = 0;
-                
-                for (int member : mySet) {
-                    if (member == rank) continue;
-                    sendInt(member, RELEASE_TAG, rank);
-                }
-                
-                log_nb(" -> Releasing my own vote.");
-                HaveVoted = false;
-                Candidate = -1;
-                Candidate_Ts = 0;
-                HaveInquired = false;
-
-                if (!WaitingQ.empty()) {
-                    auto nxt = WaitingQ.top();
-                    WaitingQ.pop();
-                    int chosen = nxt.second;
-                    Candidate = chosen;
-                    Candidate_Ts = nxt.first;
-                    HaveVoted = true; 
-                    
-                    log_nb(" -> Granting YES to " + to_string(chosen) + " (from self-release)");
-                    sendInt(chosen, YES_TAG, rank);
-                } 
-                else {
-                    log_nb(" -> My vote is now free, nobody is waiting.");
+            else if (!cl.WantCS && !stopped && now >= t.next) {
+                // a few tries for a lock this rank is not already after; otherwise next tick
+                for (int attempt = 0; attempt < 4; ++attempt) {
+                    if (mgr.acquire(c, pick(rng))) {
+                        t.requested = now;
+                        busy = true;
+                        break;
+                    }
                 }
-                done = true;
             }
+            if (mgr.ready(c)) {
+                mgr.enter(c);
+                t.entered = now_seconds();
+            }
+            active += cl.WantCS;
         }
-        auto now = chrono::steady_clock::now();
-        auto elapsed = chrono::duration_cast<chrono::milliseconds>(now - start).count();
-        if (!initiator && elapsed > (TIMEOUT_MS * 0.75) && WaitingQ.empty() && !HaveVoted) {
-             done = true;
+        mgr.flush();
+        if (stopped && active == 0 && !joined) {
+            MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+            joined = true;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (joined) MPI_Test(&barrier, &everyone_done, MPI_STATUS_IGNORE);
+        if (!busy) std::this_thread::sleep_for(std::chrono::microseconds(50));
     }
+    wait_quiescent(channel, drain);
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    if (rank == 0) cout << "=== Simulation finished (Maekawa) ===\n";
+    int n_values = records.size();
+    vector<int> counts(size), displs(size);
+    MPI_Gather(&n_values, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    vector<double> all_records;
+    if (rank == 0) {
+        int sum = 0;
+        for (int r = 0; r < size; ++r) { displs[r] = sum; sum += counts[r]; }
+        all_records.resize(sum);
+    }
+    MPI_Gatherv(records.data(), n_values, MPI_DOUBLE, all_records.data(), counts.data(), displs.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    double first_start = 0;
+    MPI_Reduce(&t_start, &first_start, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    // records per kind, messages, MPI calls; then the largest voter table
+    long long totals[NUM_KINDS + 2], sums[NUM_KINDS + 2];
+    for (int k = 0; k < NUM_KINDS; ++k) totals[k] = mgr.records[k];
+    totals[NUM_KINDS] = mgr.batches;
+    totals[NUM_KINDS + 1] = channel.calls() - calls_before;
+    MPI_Reduce(totals, sums, NUM_KINDS + 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    long long table[2] = {(long long)mgr.voters.peak(), (long long)mgr.voters.capacity()}, max_table[2];
+    MPI_Reduce(table, max_table, 2, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
 
-    MPI_Finalize();
+    if (rank == 0) {
+        // sorted by (lock, enter): each lock's intervals must not overlap
+        vector<array<double, 4>> acq;
+        for (size_t k = 0; k + 3 < all_records.size(); k += 4)
+            acq.push_back({all_records[k], all_records[k + 2], all_records[k + 3], all_records[k + 1]});
+        sort(acq.begin(), acq.end());
+        bool exclusive = true;
+        double last_exit = first_start;
+        vector<float> latency_ms;
+        for (size_t k = 0; k < acq.size(); ++k) {
+            latency_ms.push_back((acq[k][1] - acq[k][3]) * 1e3);
+            last_exit = max(last_exit, acq[k][2]);
+            if (k > 0 && acq[k][0] == acq[k - 1][0]) exclusive &= acq[k][1] >= acq[k - 1][2];
+        }
+        sort(latency_ms.begin(), latency_ms.end());
+        long long n_acq = acq.size(), n_records = 0;
+        for (int k = 0; k < NUM_KINDS; ++k) n_records += sums[k];
+        long long messages = sums[NUM_KINDS];
+        double window = last_exit - first_start;
+        double per = 1.0 / max(1LL, n_acq);
+        cout << fixed << setprecision(1) << setw(7) << locks << setw(10) << n_acq << setw(10) << (window > 0 ? n_acq / window : 0)
+             << setw(10) << n_records * per << setw(10) << messages * per << setw(10) << (double)n_records / max(1LL, messages)
+             << setw(10) << sums[NUM_KINDS + 1] * per << setprecision(3) << setw(9) << percentile(latency_ms, 0.50)
+             << setw(9) << percentile(latency_ms, 0.99) << setw(7) << max_table[0] << "/" << left << setw(6) << max_table[1]
+             << right << setw(6) << (exclusive ? "ok" : "FAIL") << endl << defaultfloat;
+    }
+}
+
+int run_dlm(int rank, int size, const string& kind, const DlmWorkload& w) {
+    const vector<vector<int>> S = build_quorums(kind, size);
+    QuorumReport q = check_quorums(S);
+    if (!q.intersecting || !q.self_member || w.clients < 1 || w.max_locks < 1) {
+        if (rank == 0) cerr << "lock manager needs valid quorums, clients >= 1 and locks >= 1\n";
+        return 1;
+    }
+    if (rank == 0) {
+        cout << "=== Maekawa lock manager (" << kind << " quorums, N = " << size << ", " << w.clients << " clients per rank, "
+             << w.seconds << " s per step, think " << w.think_ms << " ms, hold " << w.cs_ms << " ms) ===\n";
+        cout << setw(7) << "locks" << setw(10) << "acquired" << setw(10) << "acq/sec" << setw(10) << "recs/acq"
+             << setw(10) << "msgs/acq" << setw(10) << "recs/msg" << setw(10) << "calls/acq" << setw(9) << "p50 ms"
+             << setw(9) << "p99 ms" << setw(14) << "voter table" << setw(6) << "mutex" << endl;
+    }
+    WireChannel channel(MPI_COMM_WORLD);
+    vector<int> steps;
+    for (int locks = 1; locks < w.max_locks; locks *= 4) steps.push_back(locks);
+    steps.push_back(w.max_locks);
+    for (int locks : steps) run_dlm_step(channel, rank, size, S[rank], locks, w);
+    if (rank == 0) cout << "=== Lock manager finished ===\n";
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    string mode = argc > 1 ? argv[1] : "grid";
+    int status = 0;
+    if (mode == "bench") {
+        if (rank == 0) run_quorum_benchmark(argc > 2 ? atoi(argv[2]) : 1024);
+    }
+    else if (mode == "grid" || mode == "fpp" || mode == "tree" || is_token_engine(mode)) {
+        string option = argc > 2 ? argv[2] : "";
+        if (option == "dlm" && !is_token_engine(mode)) {
+            DlmWorkload d;
+            if (argc > 3) d.max_locks = atoi(argv[3]);
+            if (argc > 4) d.seconds = atof(argv[4]);
+            if (argc > 5) d.think_ms = atof(argv[5]);
+            if (argc > 6) d.cs_ms = atof(argv[6]);
+            if (argc > 7) d.clients = atoi(argv[7]);
+            status = run_dlm(rank, size, mode, d);
+        }
+        else {
+            CsWorkload w;
+            bool requester = true;
+            if (option == "load") {
+                if (argc > 3) w.seconds = atof(argv[3]);
+                if (argc > 4) w.think_ms = atof(argv[4]);
+                if (argc > 5) w.cs_ms = atof(argv[5]);
+                requester = rank < (argc > 6 ? atoi(argv[6]) : size);
+            }
+            else {
+                // one entry each, by ranks 1 and N-1 or by everyone
+                w.max_entries = 1;
+                w.seconds = 1e9;
+                w.think_ms = 0;
+                w.cs_ms = 100;
+                w.first_ms = 100 * (rank % 2);
+                w.verbose = true;
+                requester = option == "all" || rank == 1 || rank == size - 1;
+            }
+            status = run_dme(rank, size, mode, requester, w);
+        }
+    }
+    else {
+        if (rank == 0) cerr << "usage: meakawa [grid|fpp|tree|sk|raymond [all | load [seconds] [think ms] [cs ms] [requesting ranks]] | grid|fpp|tree dlm [max locks] [seconds] [think ms] [cs ms] [clients] | bench [max N]]\n";
+        status = 1;
+    }
+
+    MPI_Finalize();
+    return status;
+}
@@ -6,6 +6,8 @@
 #include <chrono>
 #include <thread>
 #include <string>
+#include "rank_log.h"
+#include "wire_msg.h"
 
 using namespace std;
 
@@ -16,19 +18,7 @@ using namespace std;
 #define ACCEPTED_TAG       14 
 #define DECIDE_TAG         15 
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
-
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-    if (size < 3) {
-        if (rank == 0) cerr << "Run with at least 3 processes.\n";
-        MPI_Finalize();
-        return 1;
-    }
-
+void run_paxos(int rank, int size) {
     int nh = -1; 
     int na = -1;
     int va = -1;
@@ -47,18 +37,23 @@ int main(int argc, char** argv) {
 
     map<int, int> vote_counts; // Map <ProposalID, Count>
     bool consensus_reached = false;
+    int decided_value = -1;
     int quorum = (size / 2) + 1;
 
+    // every message is one WireMsg: ballot in ts, value, and the last accepted ballot in aux
+    WireChannel channel(MPI_COMM_WORLD);
     auto sendPacket = [&](int dest, int tag, int _n, int _v, int _na){
-        int buf[3] = {_n, _v, _na};
-        MPI_Send(buf, 3, MPI_INT, dest, tag, MPI_COMM_WORLD);
+        channel.send(dest, {tag, rank, _n, _v, _na, 0});
     };
 
-    auto log_nb = [&](const string &msg){
-         cout << "[Rank " << rank << "] " << msg << endl;
+    // protocol trace goes to the async per-rank log (paxos.rank<N>.log)
+    RankLog event_log("paxos", rank);
+    auto log_nb = [&](LogKind kind, const char* fmt, int peer = -1, int tag = -1, long long ballot = 0, long long a = 0, long long b = 0){
+         RLOG(LOG_DEBUG, kind, fmt, peer, tag, ballot, a, b);
     };
 
     MPI_Barrier(MPI_COMM_WORLD);
+    auto start_sim = chrono::steady_clock::now();
     std::this_thread::sleep_for(std::chrono::milliseconds(100 * (rank % 3))); 
 
     auto increment_n = [&]() {
@@ -69,102 +64,131 @@ int main(int argc, char** argv) {
     if (is_proposer) {
         increment_n(); 
         proposal_active = true;
-        log_nb("Proposer: Sending <prepare, " + to_string(n) + ">");
+        log_nb(EV_SEND, "Proposer: Sending <prepare, {clock}>", -1, PREPARE_TAG, n);
         for(int i=0; i<size; i++) sendPacket(i, PREPARE_TAG, n, -1, -1);
     }
 
     bool done = false;
-    auto start_sim = chrono::steady_clock::now();
-
-    while (!done) {
-        MPI_Status status;
-        int flag = 0;
-        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
-
-        if (flag) {
-            int src = status.MPI_SOURCE;
-            int tag = status.MPI_TAG;
-            int buf[3];
-            MPI_Recv(buf, 3, MPI_INT, src, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            
-            int recv_n = buf[0];
-            int recv_v = buf[1]; 
-            int recv_na = buf[2]; 
-
-            if (tag == PREPARE_TAG) {
-                if (recv_n > nh) {
-                    nh = recv_n;
-                    sendPacket(src, PROMISE_TAG, recv_n, va, na);
-                    log_nb("Acceptor: Promised n=" + to_string(recv_n) + " (Previous na=" + to_string(na) + ")");
-                } 
-                else {
-                    sendPacket(src, PREPARE_FAILED_TAG, recv_n, -1, -1);
-                    log_nb("Acceptor: Rejected prepare n=" + to_string(recv_n) + " (Current nh=" + to_string(nh) + ")");
-                }
+    double decide_ms = 0;
+
+    auto handle = [&](const WireMsg& msg, const int32_t*) {
+        if (done) return;
+        int src = msg.sender;
+        int tag = msg.tag;
+        int recv_n = msg.ts;
+        int recv_v = msg.value;
+        int recv_na = msg.aux;
+
+        if (tag == PREPARE_TAG) {
+            if (recv_n > nh) {
+                nh = recv_n;
+                sendPacket(src, PROMISE_TAG, recv_n, va, na);
+                log_nb(EV_SEND, "Acceptor: Promised n={clock} (Previous na={a})", src, PROMISE_TAG, recv_n, na);
+            } 
+            else {
+                sendPacket(src, PREPARE_FAILED_TAG, recv_n, -1, -1);
+                log_nb(EV_SEND, "Acceptor: Rejected prepare n={clock} (Current nh={a})", src, PREPARE_FAILED_TAG, recv_n, nh);
             }
+        }
 
-            else if (tag == PROMISE_TAG) {
-                if (is_proposer && proposal_active && !proposal_phase2 && recv_n == n) {
-                    promises_received++;
-                    
-                    if (recv_na > max_na_seen) {
-                        max_na_seen = recv_na;
-                        v = recv_v;
-                        log_nb("Proposer: Observed higher na=" + to_string(recv_na) + ". Updating v to " + to_string(v));
-                    }
-
-                    if (promises_received >= quorum) {
-                        proposal_phase2 = true;                        
-                        log_nb("Proposer: Majority Reached. Sending <accept, " + to_string(n) + ", " + to_string(v) + ">");
-                        for(int i=0; i<size; i++) sendPacket(i, ACCEPT_TAG, n, v, -1);
-                    }
+        else if (tag == PROMISE_TAG) {
+            if (is_proposer && proposal_active && !proposal_phase2 && recv_n == n) {
+                promises_received++;
+                
+                if (recv_na > max_na_seen) {
+                    max_na_seen = recv_na;
+                    v = recv_v;
+                    log_nb(EV_RECV, "Proposer: Observed higher na={a}. Updating v to {b}", src, PROMISE_TAG, n, recv_na, v);
                 }
-            }
-            else if (tag == PREPARE_FAILED_TAG) {
-                if (is_proposer && recv_n == n) {
-                    proposal_active = false; 
+
+                if (promises_received >= quorum) {
+                    proposal_phase2 = true;                        
+                    log_nb(EV_SEND, "Proposer: Majority Reached. Sending <accept, {clock}, {a}>", -1, ACCEPT_TAG, n, v);
+                    for(int i=0; i<size; i++) sendPacket(i, ACCEPT_TAG, n, v, -1);
                 }
             }
-
-       // PHASE 2: ACCEPT
-            else if (tag == ACCEPT_TAG) {
-                if (recv_n >= nh) {
-                    na = recv_n;
-                    nh = recv_n; 
-                    va = recv_v;
-                    
-                    log_nb("Acceptor: Accepted <n=" + to_string(na) + ", v=" + to_string(va) + ">");
-                    
-                    for(int i=0; i<size; i++) {
-                         sendPacket(i, ACCEPTED_TAG, na, va, -1);
-                    }
-                } 
-                else log_nb("Acceptor: Ignored Accept n=" + to_string(recv_n) + " because nh=" + to_string(nh));
+        }
+        else if (tag == PREPARE_FAILED_TAG) {
+            if (is_proposer && recv_n == n) {
+                proposal_active = false; 
             }
+        }
 
-       // PHASE 3: LEARN
-            else if (tag == ACCEPTED_TAG) {
-                vote_counts[recv_n]++;
+   // PHASE 2: ACCEPT
+        else if (tag == ACCEPT_TAG) {
+            if (recv_n >= nh) {
+                na = recv_n;
+                nh = recv_n; 
+                va = recv_v;
+                
+                log_nb(EV_SEND, "Acceptor: Accepted <n={clock}, v={a}>", -1, ACCEPTED_TAG, na, va);
                 
-                if (vote_counts[recv_n] >= quorum && !consensus_reached) {
-                    consensus_reached = true;
-                    log_nb("=== CONSENSUS REACHED: Value " + to_string(recv_v) + " (Proposal n=" + to_string(recv_n) + ") ===");
-                    
-                    for(int i=0; i<size; i++) sendPacket(i, DECIDE_TAG, recv_n, recv_v, -1);
-                    done = true;
+                for(int i=0; i<size; i++) {
+                     sendPacket(i, ACCEPTED_TAG, na, va, -1);
                 }
+            } 
+            else log_nb(EV_RECV, "Acceptor: Ignored Accept n={clock} because nh={a}", src, ACCEPT_TAG, recv_n, nh);
+        }
+
+   // PHASE 3: LEARN
+        else if (tag == ACCEPTED_TAG) {
+            vote_counts[recv_n]++;
+            
+            if (vote_counts[recv_n] >= quorum && !consensus_reached) {
+                consensus_reached = true;
+                decided_value = recv_v;
+                log_nb(EV_STATE, "=== CONSENSUS REACHED: Value {a} (Proposal n={clock}) ===", -1, DECIDE_TAG, recv_n, recv_v);
+                
+                for(int i=0; i<size; i++) sendPacket(i, DECIDE_TAG, recv_n, recv_v, -1);
+                done = true;
             }
-            else if (tag == DECIDE_TAG) {
-                if(!done) {
-                    log_nb("Decide received. Value: " + to_string(recv_v));
-                    done = true;
-                }
+        }
+        else if (tag == DECIDE_TAG) {
+            if(!done) {
+                decided_value = recv_v;
+                log_nb(EV_RECV, "Decide received. Value: {a}", src, DECIDE_TAG, recv_n, recv_v);
+                done = true;
             }
         }
-        
-    }
+    };
+
+    while (!done) channel.poll(handle);
+    decide_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start_sim).count();
 
     MPI_Barrier(MPI_COMM_WORLD);
+    for (int i = 0; i < size; ++i) {
+        if (rank == i) cout << "[Rank " << rank << "] Decided value " << decided_value << endl;
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    long long sent = 0;
+    for (int c : channel.sent_to()) sent += c;
+    long long counts[2] = {sent, channel.calls()}, totals[2];
+    MPI_Reduce(counts, totals, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    double slowest_ms = 0;
+    MPI_Reduce(&decide_ms, &slowest_ms, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        cout << "Consensus round: " << slowest_ms << " ms from the start barrier until the last rank decided (proposers start up to "
+             << 100 * min(size - 1, 2) << " ms apart), " << totals[0] << " messages, "
+             << totals[1] << " MPI calls (send, probe, receive)" << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (size < 3) {
+        if (rank == 0) cerr << "Run with at least 3 processes.\n";
+        MPI_Finalize();
+        return 1;
+    }
+
+    run_paxos(rank, size);
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+// Asynchronous per-rank event logger.
+// Producers push fixed-size binary records into a single-producer /
+// single-consumer lock-free ring; a background thread formats them into a
+// fully buffered per-rank file, so the hot path never builds strings or
+// flushes. Records below RANK_LOG_MIN_LEVEL are removed at compile time,
+// e.g. build with -DRANK_LOG_MIN_LEVEL=1 to drop LOG_DEBUG.
+//
+// Format strings must be string literals (only the pointer is stored) and
+// may use the placeholders {peer} {tag} {clock} {a} {b}.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOG_DEBUG 0
+#define LOG_INFO  1
+#define LOG_WARN  2
+
+#ifndef RANK_LOG_MIN_LEVEL
+#define RANK_LOG_MIN_LEVEL LOG_DEBUG
+#endif
+
+enum LogKind : uint16_t { EV_INTERNAL, EV_SEND, EV_RECV, EV_STATE };
+
+struct LogRecord {
+    uint64_t time_ns;
+    const char* fmt;
+    int64_t clock;
+    int64_t a, b;
+    int32_t rank, peer, tag;
+    uint16_t kind, level;
+    char pad[8];
+};
+static_assert(sizeof(LogRecord) == 64, "LogRecord should fill one cache line");
+
+class RankLog {
+public:
+    static const size_t CAPACITY = 1 << 16;   // records, power of two
+
+    // writes to <dir>/<program>.rank<N>.log, dir from RANK_LOG_DIR (default cwd)
+    RankLog(const char* program, int rank) : ring_(CAPACITY), rank_(rank) {
+        const char* dir = getenv("RANK_LOG_DIR");
+        std::string path = std::string(dir ? dir : ".") + "/" + program + ".rank" + std::to_string(rank) + ".log";
+        file_ = fopen(path.c_str(), "w");
+        if (file_) setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+        instance() = this;
+        worker_ = std::thread([this] { drain_loop(); });
+    }
+
+    ~RankLog() {
+        stop_.store(true, std::memory_order_release);
+        worker_.join();
+        if (file_) fclose(file_);
+        if (instance() == this) instance() = nullptr;
+    }
+
+    RankLog(const RankLog&) = delete;
+    RankLog& operator=(const RankLog&) = delete;
+
+    static RankLog*& instance() {
+        static RankLog* log = nullptr;
+        return log;
+    }
+
+    void push(int level, LogKind kind, const char* fmt, int peer, int tag, int64_t clock, int64_t a, int64_t b) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        // ring full: wait for the drain thread rather than lose events
+        while (head - tail_.load(std::memory_order_acquire) >= CAPACITY) std::this_thread::yield();
+
+        LogRecord& r = ring_[head & (CAPACITY - 1)];
+        r.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        r.fmt = fmt;
+        r.clock = clock;
+        r.a = a;
+        r.b = b;
+        r.rank = rank_;
+        r.peer = peer;
+        r.tag = tag;
+        r.kind = kind;
+        r.level = level;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    void drain_loop() {
+        while (true) {
+            bool stopping = stop_.load(std::memory_order_acquire);
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            uint64_t head = head_.load(std::memory_order_acquire);
+            if (tail == head) {
+                if (stopping) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            for (; tail != head; ++tail) write_record(ring_[tail & (CAPACITY - 1)]);
+            tail_.store(tail, std::memory_order_release);
+        }
+        if (file_) fflush(file_);
+    }
+
+    void write_record(const LogRecord& r) {
+        if (!file_) return;
+        static const char* LEVELS[] = {"DEBUG", "INFO", "WARN"};
+        fprintf(file_, "%llu.%06llu %-5s [Rank %d] ", (unsigned long long)(r.time_ns / 1000000000ULL),
+                (unsigned long long)(r.time_ns / 1000 % 1000000), LEVELS[r.level < 3 ? r.level : 2], r.rank);
+        for (const char* p = r.fmt; *p; ++p) {
+            if (*p == '{') {
+                const char* end = strchr(p, '}');
+                if (end) {
+                    size_t len = end - p - 1;
+                    if (len == 4 && !strncmp(p + 1, "peer", 4)) { fprintf(file_, "%d", r.peer); p = end; continue; }
+                    if (len == 3 && !strncmp(p + 1, "tag", 3)) { fprintf(file_, "%d", r.tag); p = end; continue; }
+                    if (len == 5 && !strncmp(p + 1, "clock", 5)) { fprintf(file_, "%lld", (long long)r.clock); p = end; continue; }
+                    if (len == 1 && p[1] == 'a') { fprintf(file_, "%lld", (long long)r.a); p = end; continue; }
+                    if (len == 1 && p[1] == 'b') { fprintf(file_, "%lld", (long long)r.b); p = end; continue; }
+                }
+            }
+            fputc(*p, file_);
+        }
+        fputc('\n', file_);
+    }
+
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) std::atomic<bool> stop_{false};
+    std::vector<LogRecord> ring_;
+    int rank_;
+    FILE* file_ = nullptr;
+    std::thread worker_;
+};
+
+inline void rank_log_push(int level, LogKind kind, const char* fmt, int peer = -1, int tag = -1,
+                          int64_t clock = 0, int64_t a = 0, int64_t b = 0) {
+    if (RankLog* log = RankLog::instance()) log->push(level, kind, fmt, peer, tag, clock, a, b);
+}
+
+// RLOG(level, kind, "fmt literal", peer, tag, clock, a, b) -- trailing arguments optional
+#define RLOG(level, ...) \
+    do { if ((level) >= RANK_LOG_MIN_LEVEL) rank_log_push((level), __VA_ARGS__); } while (0)
@@ -1,98 +1,753 @@
 #include <iostream>
+#include <fstream>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <iomanip>
 #include <cstdlib>
 #include <ctime>
+#include <cmath>
+#include <deque>
+#include <thread>
+#include <unistd.h>
 #include <mpi.h>
+#include "load_driver.h"
+#include "rank_log.h"
 
 using namespace std;
 
 #define ELECTION_TAG 0
 #define ELECTED_TAG 1
+#define PROBE_TAG 2
+#define REPLY_TAG 3
+#define COUNT_RIGHT_TAG 4
+#define COUNT_LEFT_TAG 5
+#define HEARTBEAT_TAG 6
+#define REELECT_TAG 7
+#define REELECTED_TAG 8
+#define STOP_TAG 9
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+// direction a Hirschberg-Sinclair message travels in
+#define DIR_RIGHT 0   // towards rank + 1
+#define DIR_LEFT 1    // towards rank - 1
 
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+struct ElectionResult {
+    int leader_id = -1;
+    long long messages = 0;   // sent by this rank
+    int rounds = 0;           // longest causal chain of messages seen here
+    int phases = 0;           // Hirschberg-Sinclair phases started here
+    double elected_at = 0;    // MPI_Wtime when this rank learned the leader
+};
 
-    const int num_processes = 6;
-    if (size != num_processes) {
-        if (rank == 0) {
-            cerr << "Error: This program must be run with exactly "
-                 << num_processes << " processes." << endl;
-        }
-        MPI_Finalize();
-        return 1;
+// one ID per rank: best = ascending along the ring, worst = descending
+// (every ID travels until it reaches the maximum), random = shuffled,
+// anything else is a file with one ID per line
+vector<int> make_ids(int size, const string& order, unsigned seed) {
+    vector<int> ids(size);
+    iota(ids.begin(), ids.end(), 1);
+    if (order == "best") return ids;
+    if (order == "worst") {
+        reverse(ids.begin(), ids.end());
+        return ids;
+    }
+    if (order == "random") {
+        shuffle(ids.begin(), ids.end(), mt19937(seed));
+        return ids;
     }
 
-    // Rank :   0   1   2   3   4   5
-    // ID   :   3  32   5  80   6  12
-    vector<int> ids = {3, 32, 5, 80, 6, 12};
+    ids.clear();
+    ifstream in(order);
+    int id;
+    while ((int)ids.size() < size && in >> id) ids.push_back(id);
+    return ids;
+}
 
-    int my_id = ids[rank];
-    int neighbor_rank = (rank + 1) % size;
-    int leader_id = -1;
-    bool is_participant = false;
-    bool is_active = true;
+// neighbours tell each other how many messages they sent, then each rank
+// drains what is still in flight, so no stray message outlives the election.
+// The counts go over a duplicate communicator so a rank still electing
+// (receiving with MPI_ANY_TAG) cannot mistake them for election traffic.
+void drain_ring(MPI_Comm comm, int left, int right, long long sent_left, long long sent_right, long long received) {
+    MPI_Comm count_comm;
+    MPI_Comm_dup(comm, &count_comm);
+    long long from_left = 0, from_right = 0;
+    MPI_Request reqs[2];
+    MPI_Isend(&sent_right, 1, MPI_LONG_LONG, right, COUNT_RIGHT_TAG, count_comm, &reqs[0]);
+    MPI_Isend(&sent_left, 1, MPI_LONG_LONG, left, COUNT_LEFT_TAG, count_comm, &reqs[1]);
+    MPI_Recv(&from_left, 1, MPI_LONG_LONG, left, COUNT_RIGHT_TAG, count_comm, MPI_STATUS_IGNORE);
+    MPI_Recv(&from_right, 1, MPI_LONG_LONG, right, COUNT_LEFT_TAG, count_comm, MPI_STATUS_IGNORE);
+    MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+    MPI_Comm_free(&count_comm);
 
-    MPI_Barrier(MPI_COMM_WORLD); 
-    if (rank == 0) {
-        cout << "[Rank " << rank << ", ID " << my_id << "] Initiates the election." << endl;
-        MPI_Send(&my_id, 1, MPI_INT, neighbor_rank, ELECTION_TAG, MPI_COMM_WORLD);
-        is_participant = true;
+    int msg[5];
+    for (; received < from_left + from_right; ++received) {
+        MPI_Recv(msg, 5, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, comm, MPI_STATUS_IGNORE);
     }
+}
+
+// Chang & Roberts with every rank initiating: IDs travel right and are
+// absorbed by any larger ID; O(n^2) messages when IDs descend along the ring
+ElectionResult run_chang_roberts(MPI_Comm comm, int rank, int size, int my_id) {
+    ElectionResult res;
+    int right = (rank + 1) % size, left = (rank - 1 + size) % size;
+    long long received = 0;
+    int msg[2];
 
+    msg[0] = my_id; msg[1] = 1;
+    RLOG(LOG_INFO, EV_SEND, "[ID {a}] Initiates the election.", right, ELECTION_TAG, 0, my_id);
+    MPI_Send(msg, 2, MPI_INT, right, ELECTION_TAG, comm);
+    res.messages++;
+
+    bool is_active = true;
     while (is_active) {
-        int received_id;
         MPI_Status status;
-
-        MPI_Recv(&received_id, 1, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        MPI_Recv(msg, 2, MPI_INT, left, MPI_ANY_TAG, comm, &status);
+        received++;
+        int received_id = msg[0];
+        res.rounds = max(res.rounds, msg[1]);
+        msg[1]++;
 
         if (status.MPI_TAG == ELECTION_TAG) {
-            // Case 1: Received an election message
             if (received_id > my_id) {
-                cout << "[Rank " << rank << ", ID " << my_id
-                     << "] → Forwarding stronger candidate ID " << received_id << "." << endl;
-                MPI_Send(&received_id, 1, MPI_INT, neighbor_rank, ELECTION_TAG, MPI_COMM_WORLD);
-                is_participant = true;
+                RLOG(LOG_INFO, EV_SEND, "[ID {a}] → Forwarding stronger candidate ID {b}.", right, ELECTION_TAG, 0, my_id, received_id);
+                MPI_Send(msg, 2, MPI_INT, right, ELECTION_TAG, comm);
+                res.messages++;
+            }
+            else if (received_id < my_id) {
+                RLOG(LOG_DEBUG, EV_RECV, "[ID {a}] ← Absorbed weaker ID {b}.", left, ELECTION_TAG, 0, my_id, received_id);
+            }
+            else {
+                RLOG(LOG_INFO, EV_STATE, "[ID {a}] I AM THE LEADER!", -1, -1, 0, my_id);
+                res.leader_id = my_id;
+                res.elected_at = MPI_Wtime();
+                is_active = false;
+                MPI_Send(msg, 2, MPI_INT, right, ELECTED_TAG, comm);
+                res.messages++;
+            }
+        }
+        else if (status.MPI_TAG == ELECTED_TAG) {
+            res.leader_id = received_id;
+            res.elected_at = MPI_Wtime();
+            is_active = false;
+            RLOG(LOG_INFO, EV_RECV, "[ID {a}] Learned that the leader is ID {b}.", left, ELECTED_TAG, 0, my_id, res.leader_id);
+            if (my_id != res.leader_id) {
+                MPI_Send(msg, 2, MPI_INT, right, ELECTED_TAG, comm);
+                res.messages++;
+            }
+        }
+    }
+
+    drain_ring(comm, left, right, 0, res.messages, received);
+    return res;
+}
+
+// Hirschberg & Sinclair: in phase k each candidate probes 2^k hops in both
+// directions and only continues if both probes come back; O(n log n) messages.
+// message layout: [id, phase, hops, direction, chain]
+ElectionResult run_hirschberg_sinclair(MPI_Comm comm, int rank, int size, int my_id) {
+    ElectionResult res;
+    int right = (rank + 1) % size, left = (rank - 1 + size) % size;
+    long long sent_left = 0, sent_right = 0, received = 0;
+    int replies = 0;
+
+    auto send_dir = [&](int tag, int id, int phase, int hops, int dir, int chain) {
+        int out[5] = {id, phase, hops, dir, chain};
+        MPI_Send(out, 5, MPI_INT, dir == DIR_RIGHT ? right : left, tag, comm);
+        (dir == DIR_RIGHT ? sent_right : sent_left)++;
+    };
+    auto start_phase = [&](int chain) {
+        RLOG(LOG_INFO, EV_SEND, "[ID {a}] Starts phase {b}.", -1, PROBE_TAG, 0, my_id, res.phases);
+        send_dir(PROBE_TAG, my_id, res.phases, 1, DIR_RIGHT, chain);
+        send_dir(PROBE_TAG, my_id, res.phases, 1, DIR_LEFT, chain);
+        res.phases++;
+    };
+
+    start_phase(1);
+
+    bool is_active = true;
+    while (is_active) {
+        int msg[5];
+        MPI_Status status;
+        MPI_Recv(msg, 5, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &status);
+        received++;
+        int id = msg[0], phase = msg[1], hops = msg[2], dir = msg[3], chain = msg[4];
+        res.rounds = max(res.rounds, chain);
+
+        if (status.MPI_TAG == PROBE_TAG) {
+            if (id == my_id) {
+                // my probe went all the way round: nobody larger exists
+                if (res.leader_id != my_id) {
+                    RLOG(LOG_INFO, EV_STATE, "[ID {a}] I AM THE LEADER!", -1, -1, 0, my_id);
+                    res.leader_id = my_id;
+                    res.elected_at = MPI_Wtime();
+                    send_dir(ELECTED_TAG, my_id, phase, 0, DIR_RIGHT, chain + 1);
+                }
+            }
+            else if (id > my_id && hops < (1 << phase)) {
+                RLOG(LOG_DEBUG, EV_SEND, "[ID {a}] → Forwarding probe of ID {b}.", -1, PROBE_TAG, 0, my_id, id);
+                send_dir(PROBE_TAG, id, phase, hops + 1, dir, chain + 1);
+            }
+            else if (id > my_id) {
+                RLOG(LOG_DEBUG, EV_SEND, "[ID {a}] ← Replying to probe of ID {b}.", status.MPI_SOURCE, REPLY_TAG, 0, my_id, id);
+                send_dir(REPLY_TAG, id, phase, 0, 1 - dir, chain + 1);
+            }
+            else {
+                RLOG(LOG_DEBUG, EV_RECV, "[ID {a}] ← Absorbed probe of weaker ID {b}.", status.MPI_SOURCE, PROBE_TAG, 0, my_id, id);
             }
+        }
+        else if (status.MPI_TAG == REPLY_TAG) {
+            if (id != my_id) {
+                send_dir(REPLY_TAG, id, phase, 0, dir, chain + 1);
+            }
+            else if (++replies == 2) {
+                replies = 0;
+                start_phase(chain + 1);
+            }
+        }
+        else if (status.MPI_TAG == ELECTED_TAG) {
+            if (id == my_id) {
+                is_active = false;   // announcement went round
+            } else {
+                res.leader_id = id;
+                res.elected_at = MPI_Wtime();
+                is_active = false;
+                RLOG(LOG_INFO, EV_RECV, "[ID {a}] Learned that the leader is ID {b}.", status.MPI_SOURCE, ELECTED_TAG, 0, my_id, id);
+                send_dir(ELECTED_TAG, id, phase, 0, DIR_RIGHT, chain + 1);
+            }
+        }
+    }
+
+    res.messages = sent_left + sent_right;
+    drain_ring(comm, left, right, sent_left, sent_right, received);
+    return res;
+}
 
-            else if (received_id < my_id && !is_participant) {
-                cout << "[Rank " << rank << ", ID " << my_id
-                     << "] ← Absorbed weaker ID " << received_id
-                     << ", sending my own ID " << my_id << "as the stronger candidate." << endl;
-                MPI_Send(&my_id, 1, MPI_INT, neighbor_rank, ELECTION_TAG, MPI_COMM_WORLD);
-                is_participant = true;
+// Chang & Roberts with any set of concurrent initiators, dominated-ID
+// suppression and batching: each pass drains every candidate already queued
+// from the left, and at most the largest one goes on, and only if it beats
+// everything this rank has forwarded so far. Sends are non-blocking so a rank
+// keeps receiving while its forwards are in flight.
+ElectionResult run_coalesced(MPI_Comm comm, int rank, int size, int my_id, bool initiator) {
+    struct PendingSend {
+        int msg[2];
+        MPI_Request req;
+    };
+    ElectionResult res;
+    int right = (rank + 1) % size, left = (rank - 1 + size) % size;
+    long long received = 0;
+    int max_seen = my_id;
+    bool participant = initiator;
+    deque<PendingSend> in_flight;
+
+    auto send = [&](int tag, int id, int chain) {
+        in_flight.push_back({{id, chain}, MPI_REQUEST_NULL});
+        MPI_Isend(in_flight.back().msg, 2, MPI_INT, right, tag, comm, &in_flight.back().req);
+        res.messages++;
+    };
+
+    if (initiator) {
+        RLOG(LOG_INFO, EV_SEND, "[ID {a}] Initiates the election.", right, ELECTION_TAG, 0, my_id);
+        send(ELECTION_TAG, my_id, 1);
+    }
+
+    bool is_active = true;
+    while (is_active) {
+        int best = -1, best_chain = 0, batch = 0;
+        while (is_active) {
+            int flag = 0, msg[2];
+            MPI_Message handle;
+            MPI_Status status;
+            MPI_Improbe(left, MPI_ANY_TAG, comm, &flag, &handle, &status);
+            if (!flag) break;
+            MPI_Mrecv(msg, 2, MPI_INT, &handle, MPI_STATUS_IGNORE);
+            received++;
+            res.rounds = max(res.rounds, msg[1]);
+
+            if (status.MPI_TAG == ELECTED_TAG) {
+                res.leader_id = msg[0];
+                res.elected_at = MPI_Wtime();
+                is_active = false;
+                RLOG(LOG_INFO, EV_RECV, "[ID {a}] Learned that the leader is ID {b}.", left, ELECTED_TAG, 0, my_id, res.leader_id);
+                if (my_id != res.leader_id) send(ELECTED_TAG, msg[0], msg[1] + 1);
+            }
+            else if (msg[0] > best) {
+                best = msg[0];
+                best_chain = msg[1];
             }
+            batch++;
+        }
 
-            else if (received_id == my_id) {
-                cout << "[Rank " << rank << ", ID " << my_id
-                     << "] I AM THE LEADER!" << endl;
-                leader_id = my_id;
+        if (is_active && best >= 0) {
+            if (best == my_id) {
+                RLOG(LOG_INFO, EV_STATE, "[ID {a}] I AM THE LEADER!", -1, -1, 0, my_id);
+                res.leader_id = my_id;
+                res.elected_at = MPI_Wtime();
                 is_active = false;
-                MPI_Send(&my_id, 1, MPI_INT, neighbor_rank, ELECTED_TAG, MPI_COMM_WORLD);
+                send(ELECTED_TAG, my_id, best_chain + 1);
+            }
+            else if (best > max_seen) {
+                RLOG(LOG_DEBUG, EV_SEND, "[ID {a}] → Forwarding ID {b}, the largest of a batch of {clock}.", right, ELECTION_TAG, batch,
+                     my_id, best);
+                max_seen = best;
+                send(ELECTION_TAG, best, best_chain + 1);
             }
+            else if (!participant) {
+                send(ELECTION_TAG, my_id, best_chain + 1);
+            }
+            participant = true;
         }
 
-        else if (status.MPI_TAG == ELECTED_TAG) {
-            // Case 2: Received a leader announcement
-            leader_id = received_id;
-            is_active = false;
+        while (!in_flight.empty()) {
+            int done = 0;
+            MPI_Test(&in_flight.front().req, &done, MPI_STATUS_IGNORE);
+            if (!done) break;
+            in_flight.pop_front();
+        }
+        // nothing to overlap with: wait for the next candidate instead of spinning
+        if (is_active && best < 0) {
+            if (in_flight.empty()) MPI_Probe(left, MPI_ANY_TAG, comm, MPI_STATUS_IGNORE);
+            else this_thread::yield();
+        }
+    }
+
+    for (PendingSend& p : in_flight) MPI_Wait(&p.req, MPI_STATUS_IGNORE);
+    drain_ring(comm, left, right, 0, res.messages, received);
+    return res;
+}
+
+ElectionResult run_election(const string& algorithm, MPI_Comm comm, int rank, int size, int my_id) {
+    if (size == 1) {
+        ElectionResult res;
+        res.leader_id = my_id;
+        res.elected_at = MPI_Wtime();
+        return res;
+    }
+    if (algorithm == "hs") return run_hirschberg_sinclair(comm, rank, size, my_id);
+    if (algorithm == "co") return run_coalesced(comm, rank, size, my_id, true);
+    return run_chang_roberts(comm, rank, size, my_id);
+}
 
-            cout << "[Rank " << rank << ", ID " << my_id
-                 << "] Learned that the leader is ID " << leader_id << "." << endl;
+// both algorithms under best, worst and random ID orderings; every run gets
+// its own communicator so runs cannot see each other's messages
+void run_benchmark(int rank, int size) {
+    const string algorithms[] = {"cr", "hs"};
+    const string orders[] = {"best", "worst", "random"};
+    const int REPEATS = 3;
 
-            if (my_id != leader_id) {
-                MPI_Send(&leader_id, 1, MPI_INT, neighbor_rank, ELECTED_TAG, MPI_COMM_WORLD);
+    if (rank == 0) {
+        cout << "--- Ring Election Benchmark (" << size << " ranks) ---" << endl;
+        cout << "algorithm  ordering   messages   msgs/rank   rounds   time ms" << endl;
+    }
+    for (const string& algorithm : algorithms) {
+        for (const string& order : orders) {
+            vector<int> ids = make_ids(size, order, 2024);
+            long long total_messages = 0;
+            int max_rounds = 0;
+            double best_ms = 1e30;
+
+            for (int r = 0; r < REPEATS; ++r) {
+                MPI_Comm comm;
+                MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+                MPI_Barrier(comm);
+                double start = MPI_Wtime();
+                ElectionResult res = run_election(algorithm, comm, rank, size, ids[rank]);
+                double elapsed = res.elected_at - start, max_elapsed = 0;
+                MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+                MPI_Reduce(&res.messages, &total_messages, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+                MPI_Reduce(&res.rounds, &max_rounds, 1, MPI_INT, MPI_MAX, 0, comm);
+                MPI_Comm_free(&comm);
+                best_ms = min(best_ms, max_elapsed * 1e3);
+            }
+
+            if (rank == 0) {
+                cout << setw(9) << (algorithm == "hs" ? "H-S" : "C-R") << "  " << setw(8) << order << " "
+                     << setw(10) << total_messages << " " << setw(11) << (double)total_messages / size << " "
+                     << setw(8) << max_rounds << " " << setw(9) << best_ms << endl;
             }
         }
     }
+}
+
+// election latency and messages per election of plain Chang-Roberts vs the
+// coalescing variant for ring sizes 8, 16, ... up to the world size; each
+// size runs on a sub-communicator of the first N ranks
+void run_scaling(int rank, int size, int elections, double initiator_fraction) {
+    if (rank == 0) {
+        cout << "--- Ring Election Scaling (" << elections << " elections per size, random IDs, "
+             << initiator_fraction * 100 << "% initiators for coalesced) ---" << endl;
+        cout << "     N  algorithm  msgs/election  msgs/rank  latency p50 ms  latency p99 ms" << endl;
+    }
+    for (int n = min(8, size); ; n = min(n * 2, size)) {
+        MPI_Comm comm;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < n ? 0 : MPI_UNDEFINED, rank, &comm);
+        if (comm != MPI_COMM_NULL) {
+            // the elections run on the ring the split actually built
+            int ring_size;
+            MPI_Comm_size(comm, &ring_size);
+            for (const string algorithm : {"cr", "co"}) {
+                vector<float> latency_ms;
+                long long total_messages = 0;
+                for (int e = 0; e < elections; ++e) {
+                    vector<int> ids = make_ids(ring_size, "random", 1000 + e);
+                    bool initiator = rank == 0 || (mt19937(e * 100003 + rank)() % 1000) < initiator_fraction * 1000;
+                    MPI_Barrier(comm);
+                    double start = MPI_Wtime();
+                    ElectionResult res = algorithm == string("co") ? run_coalesced(comm, rank, ring_size, ids[rank], initiator)
+                                                                   : run_chang_roberts(comm, rank, ring_size, ids[rank]);
+                    double elapsed = res.elected_at - start, max_elapsed = 0;
+                    long long messages = 0;
+                    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+                    MPI_Reduce(&res.messages, &messages, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+                    latency_ms.push_back(max_elapsed * 1e3);
+                    total_messages += messages;
+                }
+                if (rank == 0) {
+                    sort(latency_ms.begin(), latency_ms.end());
+                    cout << setw(6) << ring_size << "  " << setw(9) << (algorithm == string("co") ? "coalesced" : "C-R") << "  "
+                         << setw(13) << (double)total_messages / elections << "  " << setw(9) << (double)total_messages / elections / ring_size
+                         << "  " << setw(14) << percentile(latency_ms, 0.50) << "  " << setw(14) << percentile(latency_ms, 0.99) << endl;
+                }
+            }
+            MPI_Comm_free(&comm);
+        }
+        // ranks outside this size sleep instead of spinning in a blocking
+        // barrier, which would steal cycles on an oversubscribed node
+        MPI_Request barrier;
+        MPI_Ibarrier(MPI_COMM_WORLD, &barrier);
+        for (int done = 0; !done; ) {
+            MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+            if (!done) usleep(1000);
+        }
+        if (n >= size) break;
+    }
+}
+
+// phi-accrual failure detector (Hayashibara et al.): suspicion grows with the
+// time since the last heartbeat, measured against the observed inter-arrival
+// distribution (approximated as normal). phi = 8 means a false suspicion has
+// a 1e-8 chance under that distribution.
+struct PhiAccrualDetector {
+    static const int WINDOW = 100;
+    deque<double> intervals;
+    double sum = 0, sum_sq = 0, last = 0;
+
+    explicit PhiAccrualDetector(double expected) {
+        add(expected);
+        add(expected);
+    }
+
+    void add(double interval) {
+        intervals.push_back(interval);
+        sum += interval;
+        sum_sq += interval * interval;
+        if ((int)intervals.size() > WINDOW) {
+            sum -= intervals.front();
+            sum_sq -= intervals.front() * intervals.front();
+            intervals.pop_front();
+        }
+    }
+
+    void heartbeat(double now) {
+        if (last > 0) add(now - last);
+        last = now;
+    }
+
+    double phi(double now) const {
+        double mean = sum / intervals.size();
+        double stddev = max(sqrt(max(0.0, sum_sq / intervals.size() - mean * mean)), 0.1 * mean);
+        double p_later = 0.5 * erfc((now - last - mean) / (stddev * sqrt(2.0)));
+        return -log10(max(p_later, 1e-300));
+    }
+};
+
+const double PHI_THRESHOLD = 8.0;
+const double TIMEOUT_HEARTBEATS = 5.0;
+
+// next rank clockwise that is not known to be dead
+int next_alive(int rank, int size, const vector<char>& dead) {
+    int r = (rank + 1) % size;
+    while (dead[r] && r != rank) r = (r + 1) % size;
+    return r;
+}
+
+// per-epoch timestamp, -1 until set; epochs outnumber crashes when a live
+// leader is falsely suspected
+double& epoch_slot(vector<double>& v, int epoch) {
+    if ((int)v.size() <= epoch) v.resize(epoch + 1, -1);
+    return v[epoch];
+}
+
+// long-running mode: the leader heartbeats everybody, each rank watches it
+// with a phi-accrual (or plain timeout) detector, and the leaders of the
+// first `crashes` epochs simulate a crash by going silent. The ranks that
+// notice start a Chang-Roberts re-election on the ring with the old leader
+// skipped. A leader that was only suspected stays excluded from the ring and
+// steps down when it hears of a newer epoch. Crash, detection and
+// new-leader times are compared on rank 0 (one node, so MPI_Wtime is a
+// common clock).
+// message layout: heartbeat/stop [epoch], election [epoch, id], elected [epoch, leader rank]
+void run_failover(int rank, int size, const vector<int>& ids, const string& detector, int crashes, double heartbeat_ms) {
+    const double period = heartbeat_ms / 1e3;
+    vector<char> dead(size, 0);
+    vector<double> crash_at, detect_at, leader_at;
+    mt19937 rng(rank * 7919 + time(NULL));
+
+    // initial leader from a normal all-initiator election
+    ElectionResult first = run_election("cr", MPI_COMM_WORLD, rank, size, ids[rank]);
+    int leader = find(ids.begin(), ids.end(), first.leader_id) - ids.begin();
+    int epoch = 0;
+    bool electing = false, participant = false, crashed = false, excluded = false, running = true;
+    PhiAccrualDetector phi(period);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double now = MPI_Wtime();
+    double next_heartbeat = now, crash_deadline = 0, stop_at = 0;
+    auto become_leader = [&]() {
+        next_heartbeat = now;
+        if (epoch < crashes) crash_deadline = now + (20 + rng() % 20) * period;
+        else stop_at = now + 20 * period;
+    };
+    if (rank == leader) become_leader();
+    phi.last = now;
+    if (rank == 0) {
+        cout << "--- Ring Failover (" << detector << " detector, " << crashes << " crashes, heartbeat "
+             << heartbeat_ms << " ms) ---" << endl;
+        cout << "Initial leader: rank " << leader << " (ID " << ids[leader] << ")" << endl;
+    }
+
+    auto start_reelection = [&](bool detected) {
+        dead[leader] = 1;
+        electing = true;
+        if (detected) epoch_slot(detect_at, epoch) = now;
+        if (!participant) {
+            participant = true;
+            int msg[2] = {epoch + 1, ids[rank]};
+            MPI_Send(msg, 2, MPI_INT, next_alive(rank, size, dead), REELECT_TAG, MPI_COMM_WORLD);
+        }
+    };
+
+    while (running) {
+        now = MPI_Wtime();
+        bool busy = false;
+
+        int flag = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+        if (flag) {
+            busy = true;
+            int msg[2];
+            MPI_Recv(msg, 2, MPI_INT, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            int tag = status.MPI_TAG;
+
+            if (tag == STOP_TAG) {
+                if (msg[0] >= epoch) running = false;   // a deposed leader's stop is stale
+            }
+            else if (crashed) {
+                // a crashed rank swallows everything without reacting
+            }
+            else if (tag == HEARTBEAT_TAG && msg[0] > epoch && (rank == leader || excluded)) {
+                // I was suspected while alive: the ring already bypasses me, so follow only
+                RLOG(LOG_WARN, EV_RECV, "[ID {a}] Deposed: rank {peer} leads epoch {clock}.", status.MPI_SOURCE, HEARTBEAT_TAG,
+                     msg[0], ids[rank]);
+                epoch = msg[0];
+                leader = status.MPI_SOURCE;
+                excluded = true;
+                crash_deadline = stop_at = 0;
+                phi.last = now;
+            }
+            else if (tag == HEARTBEAT_TAG) {
+                if (msg[0] == epoch && !electing) phi.heartbeat(now);
+            }
+            else if (tag == REELECT_TAG && msg[0] == epoch + 1) {
+                if (!electing) {
+                    RLOG(LOG_INFO, EV_RECV, "[ID {a}] Learned of the leader's failure from an election message.",
+                         status.MPI_SOURCE, REELECT_TAG, epoch, ids[rank]);
+                    start_reelection(false);
+                }
+                int id = msg[1];
+                int next = next_alive(rank, size, dead);
+                if (id > ids[rank]) {
+                    MPI_Send(msg, 2, MPI_INT, next, REELECT_TAG, MPI_COMM_WORLD);
+                }
+                else if (id == ids[rank]) {
+                    RLOG(LOG_INFO, EV_STATE, "[ID {a}] I AM THE NEW LEADER for epoch {clock}!", -1, -1, epoch + 1, ids[rank]);
+                    int out[2] = {epoch + 1, rank};
+                    MPI_Send(out, 2, MPI_INT, next, REELECTED_TAG, MPI_COMM_WORLD);
+                }
+                // smaller IDs are absorbed: this rank already sent its own
+            }
+            else if (tag == REELECTED_TAG && msg[0] == epoch + 1) {
+                epoch_slot(leader_at, epoch) = now;
+                epoch = msg[0];
+                leader = msg[1];
+                electing = participant = false;
+                phi.last = now;
+                if (leader != rank) {
+                    RLOG(LOG_INFO, EV_RECV, "[ID {a}] Learned that the new leader is rank {b}.", status.MPI_SOURCE, REELECTED_TAG,
+                         epoch, ids[rank], leader);
+                    MPI_Send(msg, 2, MPI_INT, next_alive(rank, size, dead), REELECTED_TAG, MPI_COMM_WORLD);
+                } else {
+                    become_leader();
+                }
+            }
+            // anything else is a stale election message from a finished epoch
+        }
+
+        if (!crashed && rank == leader && !excluded && !electing) {
+            if (crash_deadline > 0 && now >= crash_deadline) {
+                RLOG(LOG_WARN, EV_STATE, "[ID {a}] Simulated crash: going silent.", -1, -1, epoch, ids[rank]);
+                epoch_slot(crash_at, epoch) = now;
+                crashed = true;
+            }
+            else if (stop_at > 0 && now >= stop_at) {
+                int msg[2] = {epoch, 0};
+                for (int r = 0; r < size; ++r) {
+                    if (r != rank) MPI_Send(msg, 2, MPI_INT, r, STOP_TAG, MPI_COMM_WORLD);
+                }
+                running = false;
+            }
+            else if (now >= next_heartbeat) {
+                // dead ranks get heartbeats too, so a falsely suspected leader learns it was deposed
+                int msg[2] = {epoch, 0};
+                for (int r = 0; r < size; ++r) {
+                    if (r != rank) MPI_Send(msg, 2, MPI_INT, r, HEARTBEAT_TAG, MPI_COMM_WORLD);
+                }
+                next_heartbeat = max(next_heartbeat + period, now);
+            }
+        }
+        else if (!crashed && !excluded && !electing) {
+            bool suspect = detector == "timeout" ? now - phi.last > TIMEOUT_HEARTBEATS * period : phi.phi(now) > PHI_THRESHOLD;
+            if (suspect) {
+                RLOG(LOG_WARN, EV_STATE, "[ID {a}] Suspects leader rank {b}, starting re-election.", -1, -1, epoch, ids[rank], leader);
+                start_reelection(true);
+            }
+        }
+
+        if (!busy) usleep(100);
+    }
+
+    // let every in-flight heartbeat or election message land before reporting
+    MPI_Barrier(MPI_COMM_WORLD);
+    for (int idle = 0; idle < 100; ++idle) {
+        int flag = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+        if (!flag) { usleep(100); continue; }
+        int msg[2];
+        MPI_Recv(msg, 2, MPI_INT, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        idle = 0;
+    }
+
+    int epochs = 0;
+    MPI_Allreduce(&epoch, &epochs, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    crash_at.resize(epochs, -1);
+    detect_at.resize(epochs, -1);
+    leader_at.resize(epochs, -1);
+    vector<double> crash_global(epochs);
+    MPI_Allreduce(crash_at.data(), crash_global.data(), epochs, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    vector<double> all_detect(rank == 0 ? (size_t)size * epochs : 0), all_leader(rank == 0 ? (size_t)size * epochs : 0);
+    MPI_Gather(detect_at.data(), epochs, MPI_DOUBLE, all_detect.data(), epochs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather(leader_at.data(), epochs, MPI_DOUBLE, all_leader.data(), epochs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        vector<float> detection_ms, new_leader_ms;
+        for (int e = 0; e < epochs; ++e) {
+            double first_detect = -1, last_learned = -1;
+            int detectors = 0;
+            for (int r = 0; r < size; ++r) {
+                double d = all_detect[(size_t)r * epochs + e], l = all_leader[(size_t)r * epochs + e];
+                if (d >= 0) { detectors++; first_detect = first_detect < 0 ? d : min(first_detect, d); }
+                if (l >= 0) last_learned = max(last_learned, l);
+            }
+            // a failover without a crash before the first suspicion deposed a live leader
+            if (crash_global[e] < 0 || crash_global[e] > first_detect) {
+                cout << "Failover " << e + 1 << ": false suspicion by " << detectors << " ranks, live leader deposed" << endl;
+                continue;
+            }
+            for (int r = 0; r < size; ++r) {
+                double d = all_detect[(size_t)r * epochs + e];
+                if (d >= 0) detection_ms.push_back((d - crash_global[e]) * 1e3);
+            }
+            new_leader_ms.push_back((last_learned - crash_global[e]) * 1e3);
+            cout << "Failover " << e + 1 << ": " << detectors << " ranks detected the crash, new leader known everywhere after "
+                 << new_leader_ms.back() << " ms" << endl;
+        }
+        sort(detection_ms.begin(), detection_ms.end());
+        sort(new_leader_ms.begin(), new_leader_ms.end());
+        cout << fixed << setprecision(1)
+             << "detection latency ms: p50 " << percentile(detection_ms, 0.50) << ", p99 " << percentile(detection_ms, 0.99)
+             << ", max " << (detection_ms.empty() ? 0 : detection_ms.back()) << " (" << detection_ms.size() << " detections)" << endl;
+        cout << "time to new leader ms: p50 " << percentile(new_leader_ms, 0.50) << ", p99 " << percentile(new_leader_ms, 0.99)
+             << ", max " << (new_leader_ms.empty() ? 0 : new_leader_ms.back()) << defaultfloat << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // usage: ring [cr|hs|co] [random|best|worst|<id file>]
+    //        ring failover [phi|timeout] [crashes] [heartbeat ms]
+    //        ring bench
+    //        ring scale [elections] [initiator fraction]
+    string algorithm = argc > 1 ? argv[1] : "cr";
+    if (algorithm == "bench") {
+        run_benchmark(rank, size);
+        MPI_Finalize();
+        return 0;
+    }
+    if (algorithm == "scale") {
+        run_scaling(rank, size, argc > 2 ? atoi(argv[2]) : 20, argc > 3 ? atof(argv[3]) : 1.0);
+        MPI_Finalize();
+        return 0;
+    }
+    const bool failover = (algorithm == "failover");
+    string order = argc > 2 && !failover ? argv[2] : "random";
+
+    // rank 0 generates or loads the IDs and hands them out
+    vector<int> ids;
+    if (rank == 0) ids = make_ids(size, order, time(NULL));
+    int num_ids = ids.size();
+    MPI_Bcast(&num_ids, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    ids.resize(num_ids);
+    MPI_Bcast(ids.data(), num_ids, MPI_INT, 0, MPI_COMM_WORLD);
+    vector<int> sorted_ids = ids;
+    sort(sorted_ids.begin(), sorted_ids.end());
+    if ((int)ids.size() != size || adjacent_find(sorted_ids.begin(), sorted_ids.end()) != sorted_ids.end()) {
+        if (rank == 0) {
+            cerr << "Error: need " << size << " distinct IDs, got " << ids.size() << " from '" << order << "'." << endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    int my_id = ids[rank];
+
+    RankLog event_log("ring", rank);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) cout << "Per-event log: ring.rank<N>.log" << endl;
+
+    if (failover) {
+        int crashes = min(argc > 3 ? atoi(argv[3]) : 3, size - 1);
+        run_failover(rank, size, ids, argc > 2 ? argv[2] : "phi", crashes, argc > 4 ? atof(argv[4]) : 20);
+        MPI_Finalize();
+        return 0;
+    }
+
+    ElectionResult res = run_election(algorithm, MPI_COMM_WORLD, rank, size, my_id);
+    long long total_messages = 0;
+    MPI_Reduce(&res.messages, &total_messages, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
 
     MPI_Barrier(MPI_COMM_WORLD);
     if (rank == 0) {
         cout << "\n-------------------------------------------------\n";
-        cout << "Election Complete. Final Results:\n";
+        cout << "Election Complete (" << (algorithm == "hs" ? "Hirschberg-Sinclair" : algorithm == "co" ? "coalescing Chang-Roberts" : "Chang-Roberts")
+             << ", " << total_messages << " messages). Final Results:\n";
         cout << "-------------------------------------------------\n";
     }
     MPI_Barrier(MPI_COMM_WORLD);
@@ -100,7 +755,7 @@ int main(int argc, char** argv) {
     for (int i = 0; i < size; ++i) {
         if (rank == i) {
             cout << "   [Rank " << rank << "] My ID is " << my_id
-                 << ". The elected leader is ID " << leader_id << "." << endl;
+                 << ". The elected leader is ID " << res.leader_id << "." << endl;
         }
         MPI_Barrier(MPI_COMM_WORLD);
     }
@@ -1,149 +1,327 @@
 #include <bits/stdc++.h>
 #include <mpi.h>
-#include <unistd.h>   
+#include "csr_graph.h"
+#include "rank_log.h"
+#include "thread_pool.h"
 
 using namespace std;
 
-#define M_C_TAG 0 
-#define M_P_TAG 1
-#define M_R_TAG 2 
+// Record kinds inside a batch; every record is (kind, from vertex, to vertex).
+#define M_C_TAG 0   // child proposal
+#define M_P_TAG 1   // parent acceptance
+#define M_R_TAG 2   // rejection
 
-#define MAX_PROCESSES 10
-#define MAX_NEIGHBOURS 10
+#define M_BATCH_TAG 3   // MPI tag of a batch of records for one destination rank
+
+// per-vertex logging and the parent/children listing are only done on small graphs
+const int64_t PRINT_LIMIT = 64;
+const int64_t LOG_LIMIT = 4096;
+// largest batch sent in one message, in records
+const size_t BATCH_RECORDS = 1 << 16;
+// records per chunk handed to a worker thread
+const int64_t RECORD_GRAIN = 1024;
+
+// the original 6-vertex example, used when no edge-list file is given
+vector<HalfEdge> builtin_edges() {
+    return {{0, 1, 1}, {0, 3, 1}, {1, 2, 1}, {1, 3, 1}, {1, 4, 1}, {3, 4, 1}, {4, 5, 1}};
+}
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    const int num_processes = 6; 
-    if (size != num_processes) {
-        if (rank == 0) {
-            cerr << "Error: This program must be run with exactly " << num_processes << " processes.\n";
-            cerr << "Example: mpirun -np " << num_processes << " ./your_executable\n";
-        }
+    string path = argc > 1 ? argv[1] : "";
+    int64_t root_id = argc > 2 ? atoll(argv[2]) : 0;
+    int threads = argc > 3 ? max(1, atoi(argv[3])) : 1;
+
+    // ---- construction ----
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+    CsrGraph g;
+    if (path.empty()) {
+        vector<HalfEdge> edges = rank == 0 ? builtin_edges() : vector<HalfEdge>();
+        g = build_csr_graph(MPI_COMM_WORLD, edges, 6, false);
+    }
+    else if (!load_csr_graph(MPI_COMM_WORLD, path, g)) {
+        if (rank == 0) cerr << "Error: cannot read edge list " << path << "\n";
         MPI_Finalize();
         return 1;
     }
-    
-    vector<vector<int>>graph(num_processes, vector<int>(num_processes, 0));
-    graph[0][1] = graph[1][0] = 1;
-    graph[0][3] = graph[3][0] = 1;
-    graph[1][2] = graph[2][1] = 1;
-    graph[1][3] = graph[3][1] = 1;
-    graph[1][4] = graph[4][1] = 1;
-    graph[3][4] = graph[4][3] = 1;
-    graph[4][5] = graph[5][4] = 1;
-
-    int parent = -1;
-    vector<int> children;
-    vector<int> neighbours;
-    int noResponseRemaining = 0;
-    bool has_parent = false;
-
-    for (int i = 0; i < num_processes; ++i) {
-        if (graph[rank][i]) {
-            neighbours.push_back(i);
-        }
+    double build_time = MPI_Wtime() - t0;
+
+    const int64_t n = g.part.n;
+    if (root_id < 0 || root_id >= n) {
+        if (rank == 0) cerr << "Error: root " << root_id << " is not a vertex of a graph with " << n << " vertices.\n";
+        MPI_Finalize();
+        return 1;
     }
 
-    const int root_id = 0;
-    MPI_Request send_request;
-    MPI_Barrier(MPI_COMM_WORLD);
+    // ---- per-vertex state ----
+    // atomics, so that the worker threads of one rank can share the partition
+    vector<atomic<int64_t>> parent(g.local_n);
+    vector<atomic<int32_t>> noResponseRemaining(g.local_n);
+    vector<atomic<int32_t>> child_count(g.local_n);
+    for (auto& p : parent) p.store(-1, memory_order_relaxed);
+    const bool small = n <= PRINT_LIMIT;
 
-    srand(time(NULL) + rank);
-    sleep(rand() % 3);
-
-    if (rank == root_id) {
-        parent = root_id;
-        has_parent = true;
-        noResponseRemaining = neighbours.size();
-        cout << "[Rank " << rank << " ROOT] Sending child proposals to " 
-             << neighbours.size() << " neighbours.\n";
-        for (int nb : neighbours) {
-            MPI_Isend(NULL, 0, MPI_INT, nb, M_C_TAG, MPI_COMM_WORLD, &send_request);
-        }
-        if (noResponseRemaining == 0) {
-            cout << "[Rank " << rank << " ROOT] is isolated and has no neighbours.\n";
-        }
+    WorkStealingPool pool(threads);
+    unique_ptr<RankLog> event_log;
+    if (n <= LOG_LIMIT && pool.size() == 1) {
+        event_log.reset(new RankLog("rst", rank));
+        if (rank == 0) cout << "Per-event log: rst.rank<N>.log\n";
     }
+    const bool verbose = (bool)event_log;
 
-    while (!has_parent || noResponseRemaining > 0) {
-        MPI_Status status;
-        MPI_Recv(NULL, 0, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+    // Records are processed in rounds: everything received or queued locally
+    // is handed to the pool, each worker buffers what it produces (batches per
+    // destination rank, local records for the next round), and the calling
+    // thread alone sends the batches.
+    struct alignas(64) Worker {
+        vector<vector<int64_t>> outbox;
+        vector<int64_t> local;
+        long long proposals = 0, replies = 0;
+    };
+    vector<Worker> workers(pool.size());
+    for (auto& w : workers) w.outbox.assign(size, {});
+    vector<vector<int64_t>> outbox(size);
+    struct PendingSend { MPI_Request request; vector<int64_t> data; };
+    deque<PendingSend> in_flight;
+    long long batches_sent = 0, batches_received = 0;
+
+    auto post = [&](Worker& w, int kind, int64_t from, int64_t to) {
+        int owner = g.part.owner(to);
+        vector<int64_t>& box = owner == rank ? w.local : w.outbox[owner];
+        box.push_back(kind);
+        box.push_back(from);
+        box.push_back(to);
+        if (kind == M_C_TAG) w.proposals++;
+        else w.replies++;
+    };
 
-        int sender_rank = status.MPI_SOURCE;
-        int msg_tag = status.MPI_TAG;
-        switch (msg_tag) {
+    auto propose_to_neighbours = [&](Worker& w, int64_t lv, int64_t except) {
+        int64_t v = g.global(lv);
+        int32_t sent = 0;
+        for (int64_t k = g.offsets[lv]; k < g.offsets[lv + 1]; ++k) {
+            if (g.targets[k] == except) continue;
+            post(w, M_C_TAG, v, g.targets[k]);
+            sent++;
+        }
+        noResponseRemaining[lv].fetch_add(sent, memory_order_relaxed);
+        return sent;
+    };
+
+    auto handle = [&](Worker& w, int kind, int64_t from, int64_t to) {
+        int64_t lv = g.part.local(to);
+        switch (kind) {
             case M_C_TAG: { // Child Proposal
-                if (!has_parent) {
-                    parent = sender_rank;
-                    has_parent = true;
-                    cout << "[Rank " << rank << "] Accepted P" << parent << " as parent.\n";
-
-                    MPI_Isend(NULL, 0, MPI_INT, parent, M_P_TAG, MPI_COMM_WORLD, &send_request);
-
-                    for (int nb : neighbours) {
-                        if (nb != parent) {
-                            MPI_Isend(NULL, 0, MPI_INT, nb, M_C_TAG, MPI_COMM_WORLD, &send_request);
-                            noResponseRemaining++;
-                        }
-                    }
-
-                    if (noResponseRemaining == 0) {
-                        cout << "[Rank " << rank << "] is a LEAF node.\n";
-                    }
-                } 
+                int64_t expected = -1;
+                if (parent[lv].compare_exchange_strong(expected, from, memory_order_relaxed)) {
+                    if (verbose) RLOG(LOG_INFO, EV_RECV, "V{a}: accepted V{b} as parent.", g.part.owner(from), M_C_TAG, 0, to, from);
+                    post(w, M_P_TAG, to, from);
+                    int32_t sent = propose_to_neighbours(w, lv, from);
+                    if (verbose && sent == 0) RLOG(LOG_INFO, EV_STATE, "V{a}: is a LEAF node.", -1, -1, 0, to);
+                }
                 else {
-                    // Already has a parent → reject
-                    cout << "[Rank " << rank << "] Already has parent P" << parent 
-                         << ". Rejecting P" << sender_rank << ".\n";
-                    MPI_Isend(NULL, 0, MPI_INT, sender_rank, M_R_TAG, MPI_COMM_WORLD, &send_request);
+                    if (verbose) RLOG(LOG_INFO, EV_RECV, "V{a}: already has a parent. Rejecting V{b}.", g.part.owner(from), M_C_TAG, 0, to, from);
+                    post(w, M_R_TAG, to, from);
                 }
                 break;
             }
             case M_P_TAG: { // Parent Acceptance
-                children.push_back(sender_rank);
-                noResponseRemaining--;
-                cout << "[Rank " << rank << "] Acknowledged P" << sender_rank 
-                     << " as a child. (" << noResponseRemaining << " responses left)\n";
+                child_count[lv].fetch_add(1, memory_order_relaxed);
+                noResponseRemaining[lv].fetch_sub(1, memory_order_relaxed);
+                if (verbose) RLOG(LOG_INFO, EV_RECV, "V{a}: acknowledged V{b} as a child.", g.part.owner(from), M_P_TAG, 0, to, from);
                 break;
             }
             case M_R_TAG: { // Rejection
-                noResponseRemaining--;
-                cout << "[Rank " << rank << "] Received rejection from P" 
-                     << sender_rank << ". (" << noResponseRemaining << " responses left)\n";
+                noResponseRemaining[lv].fetch_sub(1, memory_order_relaxed);
+                if (verbose) RLOG(LOG_INFO, EV_RECV, "V{a}: received rejection from V{b}.", g.part.owner(from), M_R_TAG, 0, to, from);
                 break;
             }
         }
-        sleep(rand() % 2);
-    }
+    };
+
+    // send every non-empty outbox, in batches of at most BATCH_RECORDS records
+    auto flush = [&]() {
+        for (int r = 0; r < size; ++r) {
+            const vector<int64_t>& box = outbox[r];
+            const size_t total = box.size();
+            for (size_t lo = 0; lo < total; lo += 3 * BATCH_RECORDS) {
+                size_t hi = min(total, lo + 3 * BATCH_RECORDS);
+                if (lo == 0 && hi == box.size()) in_flight.push_back({MPI_REQUEST_NULL, move(outbox[r])});
+                else in_flight.push_back({MPI_REQUEST_NULL, vector<int64_t>(box.begin() + lo, box.begin() + hi)});
+                PendingSend& s = in_flight.back();
+                MPI_Isend(s.data.data(), (int)s.data.size(), MPI_INT64_T, r, M_BATCH_TAG, MPI_COMM_WORLD, &s.request);
+                batches_sent++;
+            }
+            outbox[r].clear();
+        }
+        while (!in_flight.empty()) {
+            int done = 0;
+            MPI_Test(&in_flight.front().request, &done, MPI_STATUS_IGNORE);
+            if (!done) break;
+            in_flight.pop_front();
+        }
+    };
 
+    // ---- tree build ----
     MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+
+    if (g.owns(root_id)) {
+        int64_t lv = g.part.local(root_id);
+        parent[lv].store(root_id);
+        int32_t sent = propose_to_neighbours(workers[0], lv, -1);
+        if (verbose) RLOG(LOG_INFO, EV_SEND, "ROOT V{b}: sending child proposals to {a} neighbours.", -1, M_C_TAG, 0, sent, root_id);
+        if (sent == 0) RLOG(LOG_WARN, EV_STATE, "ROOT: is isolated and has no neighbours.");
+    }
+
+    // Termination: the wave is finished when no record is in flight anywhere.
+    // Idle ranks sum their (batches sent, batches received) with a non-blocking
+    // allreduce; two consecutive waves with equal, unchanged totals mean every
+    // batch has been received and processed. This also covers vertices the
+    // root cannot reach, which never hear from anyone.
+    long long counts[2], totals[2], previous[2] = {-1, -1};
+    MPI_Request wave = MPI_REQUEST_NULL;
+    bool wave_open = false, finished = false;
+    vector<int64_t> work, batch;
 
-    for (int i = 0; i < size; ++i) {
-        if (rank == i) {
-            if (rank == root_id) {
-                cout << "   [Rank " << rank << " ROOT] ";
-            } 
-            else {
-                cout << "   [Rank " << rank << "] Parent: P" << parent << ". ";
+    while (!finished) {
+        // this round's records: local ones produced last round, then every batch that has arrived
+        work.clear();
+        for (Worker& w : workers) {
+            if (work.empty()) work.swap(w.local);
+            else work.insert(work.end(), w.local.begin(), w.local.end());
+            w.local.clear();
+            for (int r = 0; r < size; ++r) {
+                if (outbox[r].empty()) outbox[r].swap(w.outbox[r]);
+                else outbox[r].insert(outbox[r].end(), w.outbox[r].begin(), w.outbox[r].end());
+                w.outbox[r].clear();
             }
+        }
+        flush();
+
+        MPI_Message msg;
+        MPI_Status status;
+        int has_msg = 0;
+        MPI_Improbe(MPI_ANY_SOURCE, M_BATCH_TAG, MPI_COMM_WORLD, &has_msg, &msg, &status);
+        while (has_msg) {
+            int count;
+            MPI_Get_count(&status, MPI_INT64_T, &count);
+            batch.resize(count);
+            MPI_Mrecv(batch.data(), count, MPI_INT64_T, &msg, MPI_STATUS_IGNORE);
+            batches_received++;
+            work.insert(work.end(), batch.begin(), batch.end());
+            MPI_Improbe(MPI_ANY_SOURCE, M_BATCH_TAG, MPI_COMM_WORLD, &has_msg, &msg, &status);
+        }
+
+        if (!work.empty()) {
+            pool.parallel_for(0, work.size() / 3, RECORD_GRAIN, [&](int id, int64_t lo, int64_t hi) {
+                for (int64_t k = lo; k < hi; ++k) handle(workers[id], (int)work[3 * k], work[3 * k + 1], work[3 * k + 2]);
+            });
+            continue;
+        }
+
+        if (!wave_open) {
+            counts[0] = batches_sent;
+            counts[1] = batches_received;
+            MPI_Iallreduce(counts, totals, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD, &wave);
+            wave_open = true;
+        }
+        int done = 0;
+        MPI_Test(&wave, &done, MPI_STATUS_IGNORE);
+        if (done) {
+            wave_open = false;
+            finished = totals[0] == totals[1] && totals[0] == previous[0] && totals[1] == previous[1];
+            previous[0] = totals[0];
+            previous[1] = totals[1];
+        }
+    }
+    while (!in_flight.empty()) {
+        MPI_Wait(&in_flight.front().request, MPI_STATUS_IGNORE);
+        in_flight.pop_front();
+    }
+    double tree_time = MPI_Wtime() - t1;
 
-            if (!children.empty()) {
-                cout << "Children: ";
-                for (int child : children) cout << "P" << child << " ";
-            } 
-            else {
-                cout << "Children: None.";
+    // ---- report ----
+    long long reached = 0, pending = 0, tree_edges = 0;
+    for (int64_t lv = 0; lv < g.local_n; ++lv) {
+        if (parent[lv] >= 0) reached++;
+        pending += noResponseRemaining[lv];
+        tree_edges += child_count[lv];
+    }
+    long long proposals = 0, replies = 0;
+    for (const Worker& w : workers) {
+        proposals += w.proposals;
+        replies += w.replies;
+    }
+    long long local_stats[5] = {reached, pending, tree_edges, proposals, replies}, stats[5];
+    MPI_Reduce(local_stats, stats, 5, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    long long batch_total = 0;
+    MPI_Reduce(&batches_sent, &batch_total, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    double max_build = 0, max_tree = 0;
+    MPI_Reduce(&build_time, &max_build, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&tree_time, &max_tree, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    double graph_mb = g.memory_bytes() / 1048576.0;
+    double state_mb = (parent.capacity() * sizeof(int64_t) + noResponseRemaining.capacity() * sizeof(int32_t) +
+                       child_count.capacity() * sizeof(int32_t)) / 1048576.0;
+    double mem[2] = {graph_mb, state_mb}, mem_max[2], mem_sum[2];
+    MPI_Reduce(mem, mem_max, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(mem, mem_sum, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (small) {
+        // gather every vertex's parent and child list on rank 0 in the original format
+        vector<int64_t> mine;
+        for (int64_t lv = 0; lv < g.local_n; ++lv) mine.push_back(parent[lv]);
+        vector<int> counts_all(size), displs(size);
+        int my_count = mine.size();
+        MPI_Gather(&my_count, 1, MPI_INT, counts_all.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+        for (int r = 0, sum = 0; r < size; ++r) { displs[r] = sum; sum += counts_all[r]; }
+        vector<int64_t> parents(n);
+        MPI_Gatherv(mine.data(), my_count, MPI_INT64_T, parents.data(), counts_all.data(), displs.data(), MPI_INT64_T, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            cout << "Spanning tree rooted at V" << root_id << ":\n";
+            for (int64_t v = 0; v < n; ++v) {
+                if (v == root_id) cout << "   [V" << v << " ROOT] ";
+                else if (parents[v] < 0) { cout << "   [V" << v << "] unreachable from the root.\n"; continue; }
+                else cout << "   [V" << v << " @ Rank " << g.part.owner(v) << "] Parent: V" << parents[v] << ". ";
+
+                vector<int64_t> kids;
+                for (int64_t u = 0; u < n; ++u)
+                    if (u != root_id && parents[u] == v) kids.push_back(u);
+                if (!kids.empty()) {
+                    cout << "Children: ";
+                    for (int64_t child : kids) cout << "V" << child << " ";
+                }
+                else {
+                    cout << "Children: None.";
+                }
+                cout << "\n";
             }
-            cout << "\n";
         }
-        MPI_Barrier(MPI_COMM_WORLD);
     }
 
+    if (rank == 0) {
+        cout << fixed << setprecision(3);
+        cout << "Graph: " << n << " vertices, " << g.global_edges << " edges on " << size << " ranks x " << threads << " threads ("
+             << g.part.block << " vertices per rank)\n";
+        cout << "Construction time: " << max_build << " s\n";
+        cout << "Memory per rank:   CSR max " << mem_max[0] << " MB avg " << mem_sum[0] / size
+             << " MB, tree state max " << mem_max[1] << " MB avg " << mem_sum[1] / size << " MB\n";
+        cout << "Tree-build time:   " << max_tree << " s\n";
+        cout << "Reached " << stats[0] << " of " << n << " vertices, tree edges " << stats[2]
+             << (stats[2] == stats[0] - 1 && stats[1] == 0 ? " (consistent)" : " (INCONSISTENT)") << "\n";
+        cout << "Messages: " << stats[3] << " proposals, " << stats[4] << " replies in " << batch_total << " MPI batches\n";
+    }
+
+    event_log.reset();
     MPI_Finalize();
     return 0;
 }
@@ -0,0 +1,136 @@
+#pragma once
+
+// Work-stealing thread pool for the hybrid MPI + threads engines.
+// parallel_for() cuts a range into chunks and deals them round-robin onto
+// per-worker deques. Each worker pops from the back of its own deque; a
+// worker whose deque is empty steals from the front of the others, so a few
+// high-degree vertices do not leave the remaining threads idle. The calling
+// thread is worker 0 and the only one that talks to MPI, which keeps
+// MPI_THREAD_FUNNELED sufficient. Between parallel_for() calls the helper
+// threads sleep on a condition variable rather than spin, since ranks and
+// threads may share cores.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    using ChunkFn = std::function<void(int worker, int64_t lo, int64_t hi)>;
+
+    explicit WorkStealingPool(int threads) : queues_(threads < 1 ? 1 : threads) {
+        for (auto& q : queues_) q.reset(new Queue);
+        for (int w = 1; w < size(); ++w) helpers_.emplace_back([this, w] { helper_loop(w); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : helpers_) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return (int)queues_.size(); }
+    long long steals() const { return steals_.load(std::memory_order_relaxed); }
+
+    // run fn over [begin, end) in chunks of at most `grain`; returns when every chunk is done
+    void parallel_for(int64_t begin, int64_t end, int64_t grain, ChunkFn fn) {
+        if (end <= begin) return;
+        if (size() == 1) {
+            fn(0, begin, end);
+            return;
+        }
+        if (grain < 1) grain = 1;
+        fn_ = std::move(fn);
+        // a helper still leaving the previous call may grab a chunk as soon as it is queued
+        remaining_.store((end - begin + grain - 1) / grain, std::memory_order_release);
+        int64_t chunk = 0;
+        for (int64_t lo = begin; lo < end; lo += grain, ++chunk) {
+            Queue& q = *queues_[chunk % size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.chunks.push_back({lo, std::min(end, lo + grain)});
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            generation_++;
+        }
+        wake_.notify_all();
+
+        run_chunks(0);
+        while (remaining_.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::pair<int64_t, int64_t>> chunks;
+    };
+
+    bool take(int worker, std::pair<int64_t, int64_t>& chunk) {
+        {
+            Queue& own = *queues_[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.chunks.empty()) {
+                chunk = own.chunks.back();
+                own.chunks.pop_back();
+                return true;
+            }
+        }
+        for (int k = 1; k < size(); ++k) {
+            Queue& victim = *queues_[(worker + k) % size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.chunks.empty()) {
+                chunk = victim.chunks.front();
+                victim.chunks.pop_front();
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run_chunks(int worker) {
+        std::pair<int64_t, int64_t> chunk;
+        while (take(worker, chunk)) {
+            fn_(worker, chunk.first, chunk.second);
+            remaining_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    void helper_loop(int worker) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            run_chunks(worker);
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> helpers_;
+    ChunkFn fn_;
+    std::atomic<int64_t> remaining_{0};
+    std::atomic<long long> steals_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
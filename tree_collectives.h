@@ -0,0 +1,136 @@
+#pragma once
+
+// Collectives over an explicit rooted spanning tree of the ranks, such as the
+// one bfs_async.cpp or rst.cpp builds: broadcast (root to leaves), reduce
+// (convergecast of sum/min/max to the root) and barrier (convergecast
+// followed by a broadcast).
+//
+// Payloads are cut into chunks of chunk_bytes and pipelined. An inner rank
+// forwards chunk c to its children while it receives chunk c + 1, so a large
+// message costs about depth + chunks steps instead of depth * chunks. Traffic
+// goes over a private duplicate of the communicator, so it never mixes with
+// the tree-building protocol's own messages. Constructing the object is
+// collective; set_tree() can be called later, once parent and children are
+// known.
+
+#include <mpi.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+enum TreeOp { TREE_SUM, TREE_MIN, TREE_MAX };
+
+class TreeCollectives {
+public:
+    static const size_t DEFAULT_CHUNK = 64 * 1024;
+
+    explicit TreeCollectives(MPI_Comm comm, size_t chunk_bytes = DEFAULT_CHUNK) : chunk_(chunk_bytes) {
+        MPI_Comm_dup(comm, &comm_);
+    }
+
+    ~TreeCollectives() { MPI_Comm_free(&comm_); }
+
+    TreeCollectives(const TreeCollectives&) = delete;
+    TreeCollectives& operator=(const TreeCollectives&) = delete;
+
+    // parent < 0 marks the root
+    void set_tree(int parent, const std::vector<int>& children) {
+        parent_ = parent;
+        children_ = children;
+    }
+
+    bool is_root() const { return parent_ < 0; }
+    int parent() const { return parent_; }
+    const std::vector<int>& children() const { return children_; }
+
+    // true once the parent has started a broadcast towards this rank
+    bool bcast_pending() const {
+        if (is_root()) return false;
+        int flag = 0;
+        MPI_Iprobe(parent_, BCAST_TAG, comm_, &flag, MPI_STATUS_IGNORE);
+        return flag != 0;
+    }
+
+    // the root's buffer is copied into every rank's buffer
+    void bcast(void* buf, size_t bytes) {
+        char* data = static_cast<char*>(buf);
+        std::vector<MPI_Request> sends;
+        sends.reserve(children_.size() * chunks(bytes));
+        for (size_t off = 0; off < bytes || off == 0; off += chunk_) {
+            int len = (int)std::min(chunk_, bytes - off);
+            if (!is_root()) MPI_Recv(data + off, len, MPI_BYTE, parent_, BCAST_TAG, comm_, MPI_STATUS_IGNORE);
+            for (int child : children_) {
+                sends.emplace_back();
+                MPI_Isend(data + off, len, MPI_BYTE, child, BCAST_TAG, comm_, &sends.back());
+            }
+            if (bytes == 0) break;
+        }
+        MPI_Waitall((int)sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+    }
+
+    // elementwise op over every rank's `in`; the result lands in the root's `out`
+    // (out is untouched elsewhere and may be null there)
+    template <class T>
+    void reduce(const T* in, T* out, size_t count, TreeOp op) {
+        const size_t per_chunk = std::max<size_t>(1, chunk_ / sizeof(T));
+        acc_.resize(count * sizeof(T));
+        T* acc = reinterpret_cast<T*>(acc_.data());
+        std::memcpy(acc, in, count * sizeof(T));
+        scratch_.resize(children_.size() * per_chunk * sizeof(T));
+        T* scratch = reinterpret_cast<T*>(scratch_.data());
+
+        std::vector<MPI_Request> recvs(children_.size()), sends;
+        sends.reserve(chunks(count * sizeof(T)));
+        for (size_t off = 0; off < count || off == 0; off += per_chunk) {
+            size_t len = std::min(per_chunk, count - off);
+            for (size_t c = 0; c < children_.size(); ++c)
+                MPI_Irecv(scratch + c * per_chunk, (int)(len * sizeof(T)), MPI_BYTE, children_[c], REDUCE_TAG, comm_, &recvs[c]);
+            MPI_Waitall((int)recvs.size(), recvs.data(), MPI_STATUSES_IGNORE);
+            for (size_t c = 0; c < children_.size(); ++c) combine(acc + off, scratch + c * per_chunk, len, op);
+            if (!is_root()) {
+                sends.emplace_back();
+                MPI_Isend(acc + off, (int)(len * sizeof(T)), MPI_BYTE, parent_, REDUCE_TAG, comm_, &sends.back());
+            }
+            if (count == 0) break;
+        }
+        MPI_Waitall((int)sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+        if (is_root() && out) std::memcpy(out, acc, count * sizeof(T));
+    }
+
+    // reduce to the root, then broadcast the result back down
+    template <class T>
+    void allreduce(const T* in, T* out, size_t count, TreeOp op) {
+        reduce(in, out, count, op);
+        bcast(out, count * sizeof(T));
+    }
+
+    // nobody leaves before everyone has arrived: empty convergecast, then empty broadcast
+    void barrier() {
+        char token = 0;
+        reduce<char>(&token, &token, 0, TREE_SUM);
+        bcast(&token, 0);
+    }
+
+private:
+    static const int BCAST_TAG = 0;
+    static const int REDUCE_TAG = 1;
+
+    size_t chunks(size_t bytes) const { return std::max<size_t>(1, (bytes + chunk_ - 1) / chunk_); }
+
+    template <class T>
+    static void combine(T* acc, const T* other, size_t len, TreeOp op) {
+        switch (op) {
+            case TREE_SUM: for (size_t i = 0; i < len; ++i) acc[i] += other[i]; break;
+            case TREE_MIN: for (size_t i = 0; i < len; ++i) acc[i] = std::min(acc[i], other[i]); break;
+            case TREE_MAX: for (size_t i = 0; i < len; ++i) acc[i] = std::max(acc[i], other[i]); break;
+        }
+    }
+
+    MPI_Comm comm_;
+    size_t chunk_;
+    int parent_ = -1;
+    std::vector<int> children_;
+    std::vector<char> acc_, scratch_;
+};
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "clock_kernels.h"
+#include "vc_trace.h"
+
+using namespace std;
+
+// Offline happened-before analyzer for vector_clock.rank<N>.trace files.
+//
+// For an event f on rank j and another rank i, the events of rank i that
+// happened before f are a prefix (those with own entry <= f.vc[i]) and the
+// events f happened before are a suffix (column j is non-decreasing along
+// rank i, so a binary search finds where it reaches f's event number).
+// Everything in between is concurrent with f, which gives exact pair counts
+// in O(E * N * log E) instead of O(E^2) comparisons.
+//
+// usage: vc_analyze [-t threads] [--pairs K] vector_clock.rank*.trace
+
+struct RankTrace {
+    int rank = -1;
+    int width = 0;
+    uint32_t record_size = 0;
+    size_t events = 0;
+    const char* base = nullptr;
+    size_t mapped = 0;
+
+    const VcTraceRecord* rec(size_t k) const {
+        return (const VcTraceRecord*)(base + sizeof(VcTraceHeader) + k * record_size);
+    }
+    const int32_t* vc(size_t k) const {
+        return (const int32_t*)(base + sizeof(VcTraceHeader) + k * record_size + sizeof(VcTraceRecord));
+    }
+};
+
+// mmap a trace file and validate its header
+bool map_trace(const char* path, RankTrace& t) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        cerr << "Cannot open " << path << endl;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    if ((size_t)st.st_size < sizeof(VcTraceHeader)) {
+        cerr << path << ": too short to be a trace" << endl;
+        close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        cerr << "Cannot mmap " << path << endl;
+        return false;
+    }
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    const VcTraceHeader* h = (const VcTraceHeader*)p;
+    if (memcmp(h->magic, VC_TRACE_MAGIC, sizeof(h->magic)) != 0 || h->record_size != vc_trace_record_size(h->width)) {
+        cerr << path << ": not a vector clock trace" << endl;
+        munmap(p, st.st_size);
+        return false;
+    }
+    t.rank = h->rank;
+    t.width = h->width;
+    t.record_size = h->record_size;
+    t.base = (const char*)p;
+    t.mapped = st.st_size;
+    t.events = (st.st_size - sizeof(VcTraceHeader)) / h->record_size;
+    return true;
+}
+
+// first event of `t` whose column `col` is >= value
+size_t lower_bound_column(const RankTrace& t, int col, int value) {
+    size_t lo = 0, hi = t.events;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (t.vc(mid)[col] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int main(int argc, char** argv) {
+    int num_threads = max(1u, thread::hardware_concurrency());
+    int sample_pairs = 0;
+    vector<const char*> paths;
+    for (int a = 1; a < argc; ++a) {
+        if (!strcmp(argv[a], "-t") && a + 1 < argc) num_threads = max(1, atoi(argv[++a]));
+        else if (!strcmp(argv[a], "--pairs") && a + 1 < argc) sample_pairs = atoi(argv[++a]);
+        else paths.push_back(argv[a]);
+    }
+    if (paths.empty()) {
+        cerr << "usage: " << argv[0] << " [-t threads] [--pairs K] vector_clock.rank*.trace" << endl;
+        return 1;
+    }
+
+    auto t_start = chrono::steady_clock::now();
+
+    // load: one trace per rank, all with the same width
+    int width = -1;
+    vector<RankTrace> loaded(paths.size());
+    for (size_t f = 0; f < paths.size(); ++f) {
+        if (!map_trace(paths[f], loaded[f])) return 1;
+        if (width == -1) width = loaded[f].width;
+        if (loaded[f].width != width || loaded[f].rank < 0 || loaded[f].rank >= width) {
+            cerr << paths[f] << ": width/rank does not match the other traces" << endl;
+            return 1;
+        }
+    }
+    vector<RankTrace> traces(width);
+    for (auto& t : loaded) {
+        if (traces[t.rank].base) {
+            cerr << "Duplicate trace for rank " << t.rank << endl;
+            return 1;
+        }
+        traces[t.rank] = t;
+    }
+
+    // flatten (rank, event) so threads can split the work evenly
+    vector<size_t> offset(width + 1, 0);
+    for (int r = 0; r < width; ++r) offset[r + 1] = offset[r] + traces[r].events;
+    const size_t total_events = offset[width];
+
+    auto run_parallel = [&](auto body) {
+        vector<thread> pool;
+        size_t chunk = (total_events + num_threads - 1) / num_threads;
+        for (int t = 0; t < num_threads; ++t) {
+            size_t lo = min(total_events, t * chunk), hi = min(total_events, lo + chunk);
+            pool.emplace_back([&, t, lo, hi] { body(t, lo, hi); });
+        }
+        for (auto& th : pool) th.join();
+    };
+    auto locate = [&](size_t g, int& r, size_t& k) {
+        r = upper_bound(offset.begin(), offset.end(), g) - offset.begin() - 1;
+        k = g - offset[r];
+    };
+
+    // validate: every event ticks its own entry exactly once
+    vector<long long> bad_ticks(num_threads, 0), kinds(3 * num_threads, 0);
+    run_parallel([&](int t, size_t lo, size_t hi) {
+        for (size_t g = lo; g < hi; ++g) {
+            int r; size_t k;
+            locate(g, r, k);
+            if (traces[r].vc(k)[r] != (int)k + 1) bad_ticks[t]++;
+            kinds[3 * t + min<int>(traces[r].rec(k)->kind, 2)]++;
+        }
+    });
+    long long bad = 0, n_internal = 0, n_send = 0, n_recv = 0;
+    for (int t = 0; t < num_threads; ++t) {
+        bad += bad_ticks[t];
+        n_internal += kinds[3 * t];
+        n_send += kinds[3 * t + 1];
+        n_recv += kinds[3 * t + 2];
+    }
+    auto t_loaded = chrono::steady_clock::now();
+
+    // concurrent pairs, counted once from each side
+    vector<vector<long long>> pair_counts(num_threads, vector<long long>((size_t)width * width, 0));
+    run_parallel([&](int t, size_t lo, size_t hi) {
+        vector<long long>& counts = pair_counts[t];
+        for (size_t g = lo; g < hi; ++g) {
+            int j; size_t k;
+            locate(g, j, k);
+            const int32_t* f = traces[j].vc(k);
+            for (int i = 0; i < width; ++i) {
+                if (i == j || traces[i].events == 0) continue;
+                size_t before = min<size_t>(max(f[i], 0), traces[i].events);
+                size_t after_start = lower_bound_column(traces[i], j, f[j]);
+                if (after_start > before) counts[(size_t)j * width + i] += after_start - before;
+            }
+        }
+    });
+    vector<long long> concurrent((size_t)width * width, 0);
+    long long concurrent_total = 0;
+    for (auto& counts : pair_counts) {
+        for (size_t c = 0; c < counts.size(); ++c) concurrent[c] += counts[c];
+    }
+    for (long long c : concurrent) concurrent_total += c;
+    concurrent_total /= 2;
+    auto t_concurrent = chrono::steady_clock::now();
+
+    // longest causal chain: DP over a topological order built from per-rank
+    // cursors; a receive waits until its matching send has been processed
+    vector<vector<int>> chain(width);
+    vector<vector<pair<int, int>>> pred(width);
+    for (int r = 0; r < width; ++r) {
+        chain[r].assign(traces[r].events, 0);
+        pred[r].assign(traces[r].events, {-1, -1});
+    }
+    vector<size_t> cursor(width, 0);
+    long long message_violations = 0, unmatched_receives = 0;
+    size_t processed = 0;
+    while (processed < total_events) {
+        size_t progress = processed;
+        for (int r = 0; r < width; ++r) {
+            for (; cursor[r] < traces[r].events; ++cursor[r]) {
+                size_t k = cursor[r];
+                const VcTraceRecord* e = traces[r].rec(k);
+                int best = k > 0 ? chain[r][k - 1] : 0;
+                pair<int, int> from = k > 0 ? make_pair(r, (int)k - 1) : make_pair(-1, -1);
+
+                if (e->kind == VC_RECEIVE) {
+                    int s = e->peer;
+                    int sk = e->peer_event - 1;
+                    bool known = s >= 0 && s < width && sk >= 0 && (size_t)sk < traces[s].events;
+                    if (known && (size_t)sk >= cursor[s]) break;   // send not processed yet
+                    if (known) {
+                        if (clock_compare(traces[s].vc(sk), traces[r].vc(k), width) != CLOCK_BEFORE) message_violations++;
+                        if (chain[s][sk] > best) {
+                            best = chain[s][sk];
+                            from = {s, sk};
+                        }
+                    } else {
+                        unmatched_receives++;
+                    }
+                }
+                chain[r][k] = best + 1;
+                pred[r][k] = from;
+                processed++;
+            }
+        }
+        if (processed == progress) {
+            cerr << "Trace has a causal cycle; cannot order events." << endl;
+            return 1;
+        }
+    }
+    int end_rank = -1, end_event = -1, longest = 0;
+    for (int r = 0; r < width; ++r) {
+        for (size_t k = 0; k < traces[r].events; ++k) {
+            if (chain[r][k] > longest) {
+                longest = chain[r][k];
+                end_rank = r;
+                end_event = k;
+            }
+        }
+    }
+    auto t_chain = chrono::steady_clock::now();
+
+    // report
+    long double cross_pairs = 0;
+    for (int i = 0; i < width; ++i) {
+        for (int j = i + 1; j < width; ++j) cross_pairs += (long double)traces[i].events * traces[j].events;
+    }
+    cout << "--- Vector Clock Trace Analysis ---" << endl;
+    cout << "ranks: " << paths.size() << "/" << width << ", events: " << total_events << " (send " << n_send
+         << ", receive " << n_recv << ", internal " << n_internal << "), threads: " << num_threads << endl;
+    if (bad) cout << "WARNING: " << bad << " events do not tick their own entry exactly once" << endl;
+    if (unmatched_receives) cout << "WARNING: " << unmatched_receives << " receives have no matching send in the traces" << endl;
+    if (message_violations) cout << "WARNING: " << message_violations << " receives are not causally after their send" << endl;
+
+    cout << "concurrent pairs: " << concurrent_total << " of " << (long long)cross_pairs << " cross-rank pairs ("
+         << fixed << setprecision(2) << (cross_pairs > 0 ? 100.0L * concurrent_total / cross_pairs : 0) << "%)"
+         << defaultfloat << endl;
+    if (width <= 16) {
+        cout << "concurrent pairs per rank pair:" << endl;
+        for (int j = 0; j < width; ++j) {
+            cout << "  ";
+            for (int i = 0; i < width; ++i) cout << setw(10) << concurrent[(size_t)j * width + i];
+            cout << endl;
+        }
+    }
+
+    for (int r = 0, shown = 0; r < width && shown < sample_pairs; ++r) {
+        for (size_t k = 0; k < traces[r].events && shown < sample_pairs; ++k) {
+            const int32_t* f = traces[r].vc(k);
+            for (int i = r + 1; i < width && shown < sample_pairs; ++i) {
+                size_t before = min<size_t>(max(f[i], 0), traces[i].events);
+                size_t after_start = lower_bound_column(traces[i], r, f[r]);
+                for (size_t c = before; c < after_start && shown < sample_pairs; ++c, ++shown) {
+                    cout << "  concurrent: P" << r << ":e" << k + 1 << " || P" << i << ":e" << c + 1 << endl;
+                }
+            }
+        }
+    }
+
+    cout << "longest causal chain: " << longest << " events";
+    if (end_rank >= 0) {
+        vector<pair<int, int>> path;
+        for (pair<int, int> at = {end_rank, end_event}; at.first >= 0; at = pred[at.first][at.second]) path.push_back(at);
+        reverse(path.begin(), path.end());
+        int hops = 0;
+        for (size_t p = 1; p < path.size(); ++p) hops += path[p].first != path[p - 1].first;
+        cout << ", " << hops << " messages, ends at P" << end_rank << ":e" << end_event + 1 << endl;
+        cout << "  chain:";
+        const size_t SHOW = 12;
+        for (size_t p = 0; p < path.size(); ++p) {
+            bool hop = p > 0 && path[p].first != path[p - 1].first;
+            if (p != 0 && p != path.size() - 1 && !hop && path[p + 1].first == path[p].first) continue;
+            if (path.size() > 2 * SHOW && p == SHOW) cout << " ...";
+            if (path.size() > 2 * SHOW && p >= SHOW && p < path.size() - SHOW) continue;
+            cout << (p ? (hop ? " => " : " -> ") : " ") << "P" << path[p].first << ":e" << path[p].second + 1;
+        }
+    }
+    cout << endl;
+
+    auto secs = [](auto a, auto b) { return chrono::duration<double>(b - a).count(); };
+    cout << fixed << setprecision(3) << "time: load " << secs(t_start, t_loaded) << " s, concurrency "
+         << secs(t_loaded, t_concurrent) << " s, chains " << secs(t_concurrent, t_chain) << " s" << endl;
+
+    for (auto& t : loaded) munmap((void*)t.base, t.mapped);
+    return 0;
+}
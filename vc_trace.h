@@ -0,0 +1,73 @@
+#pragma once
+
+// Compact binary trace of vector-clock events, one append-only file per rank.
+// Layout: a VcTraceHeader followed by fixed-size records, each a
+// VcTraceRecord immediately followed by `width` int32 clock entries, so a
+// reader can mmap the file and index event k at
+// sizeof(VcTraceHeader) + k * record_size.
+// Every event ticks the rank's own entry exactly once, hence event k of
+// rank r carries vc[r] == k + 1.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+const char VC_TRACE_MAGIC[8] = {'V', 'C', 'T', 'R', 'A', 'C', 'E', '1'};
+
+enum VcTraceKind : uint8_t { VC_INTERNAL = 0, VC_SEND = 1, VC_RECEIVE = 2 };
+
+struct VcTraceHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t rank;
+    int32_t width;
+    uint32_t record_size;
+};
+
+struct VcTraceRecord {
+    uint8_t kind;
+    uint8_t pad[3];
+    int32_t peer;          // destination of a send, source of a receive, -1 otherwise
+    int32_t peer_event;    // for a receive: the sender's event number (its own vc entry at send)
+    int32_t reserved;
+};
+
+static_assert(sizeof(VcTraceHeader) == 24, "trace header layout changed");
+static_assert(sizeof(VcTraceRecord) == 16, "trace record layout changed");
+
+inline uint32_t vc_trace_record_size(int width) { return sizeof(VcTraceRecord) + width * sizeof(int32_t); }
+
+class VcTraceWriter {
+public:
+    VcTraceWriter(const std::string& path, int rank, int width) : width_(width) {
+        file_ = fopen(path.c_str(), "wb");
+        if (!file_) return;
+        setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+        VcTraceHeader h;
+        memcpy(h.magic, VC_TRACE_MAGIC, sizeof(h.magic));
+        h.version = 1;
+        h.rank = rank;
+        h.width = width;
+        h.record_size = vc_trace_record_size(width);
+        fwrite(&h, sizeof(h), 1, file_);
+    }
+
+    ~VcTraceWriter() {
+        if (file_) fclose(file_);
+    }
+
+    VcTraceWriter(const VcTraceWriter&) = delete;
+    VcTraceWriter& operator=(const VcTraceWriter&) = delete;
+
+    void record(VcTraceKind kind, int peer, int peer_event, const int* vc) {
+        if (!file_) return;
+        VcTraceRecord r = {kind, {0, 0, 0}, peer, peer_event, 0};
+        fwrite(&r, sizeof(r), 1, file_);
+        fwrite(vc, sizeof(int32_t), width_, file_);
+    }
+
+private:
+    FILE* file_ = nullptr;
+    int width_;
+};
@@ -1,14 +1,26 @@
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <string>
 #include <sstream>
+#include <iomanip>
 #include <algorithm>
 #include <cstdlib>
 #include <ctime>
+#include <chrono>
+#include <random>
+#include <memory>
 #include <unistd.h>
 #include <mpi.h>
+#include "clock_kernels.h"
+#include "load_driver.h"
+#include "rank_log.h"
+#include "vc_trace.h"
+#include "causal_broadcast.h"
+#include "itc.h"
 using namespace std;
 int w_s;
+ClockKernels vc_kernels;
 
 // print vector clock fxn
 void print_vc(int rank, const string& message, const vector<int>& vc) {
@@ -27,24 +39,637 @@ void update(vector<int>& my_vc, int world_rank, const vector<int>& recv_vc) {
         my_vc[world_rank]++;
         return;
     }
-    for (int k = 0; k < w_s; ++k) {
-        my_vc[k] = max(my_vc[k], recv_vc[k]);
-    }
+    vc_kernels.merge(my_vc.data(), recv_vc.data(), w_s);
+    my_vc[world_rank]++;
+}
+
+// Singhal-Kshemkalyani differential state: last_sent[j] is my own entry when I
+// last sent to j, last_update[k] is my own entry when my_vc[k] last changed.
+// Correct only over FIFO channels, which MPI guarantees per (source, tag, comm).
+struct DiffState {
+    vector<int> last_sent;
+    vector<int> last_update;
+};
+
+// tick own entry and remember when it changed
+void tick_diff(vector<int>& my_vc, int world_rank, DiffState& ds) {
     my_vc[world_rank]++;
+    ds.last_update[world_rank] = my_vc[world_rank];
+}
+
+// encode (index, value) pairs changed since the last send to dest
+void encode_diff(const vector<int>& my_vc, int world_rank, int dest, DiffState& ds, vector<int>& out) {
+    out.clear();
+    for (int k = 0; k < (int)my_vc.size(); ++k) {
+        if (ds.last_update[k] > ds.last_sent[dest]) {
+            out.push_back(k);
+            out.push_back(my_vc[k]);
+        }
+    }
+    ds.last_sent[dest] = my_vc[world_rank];
+}
+
+// merge sparse (index, value) pairs into my_vc
+void update_diff(vector<int>& my_vc, int world_rank, const int* pairs, int num_ints, DiffState& ds) {
+    tick_diff(my_vc, world_rank, ds);
+    for (int p = 0; p + 1 < num_ints; p += 2) {
+        int k = pairs[p], v = pairs[p + 1];
+        if (v > my_vc[k]) {
+            my_vc[k] = v;
+            ds.last_update[k] = my_vc[world_rank];
+        }
+    }
+}
+
+// sender's own entry carried by a message, i.e. its event number for the trace
+int sender_event(const int* msg, int count, int source, bool differential) {
+    if (!differential) return msg[source];
+    for (int p = 0; p + 1 < count; p += 2) {
+        if (msg[p] == source) return msg[p + 1];
+    }
+    return -1;
+}
+
+// per-rank binary trace file, next to the event log
+string trace_path(int rank) {
+    const char* dir = getenv("RANK_LOG_DIR");
+    return string(dir ? dir : ".") + "/vector_clock.rank" + to_string(rank) + ".trace";
+}
+
+// offline comparison of full vs differential transmission for growing N.
+// simulates N processes in one address space with immediate (FIFO) delivery.
+void run_benchmark() {
+    const int sizes[] = {16, 64, 256, 512, 1024};
+    const int EVENTS_PER_PROCESS = 50;
+    const int NEIGHBOURS = 8;
+
+    cout << "--- Vector Clock Transmission Benchmark ---" << endl;
+    cout << "pattern     N     full B/msg  diff B/msg  full ns/merge  diff ns/merge" << endl;
+
+    for (int pattern = 0; pattern < 2; ++pattern) {
+        for (int n : sizes) {
+            w_s = n;
+            vc_kernels = select_clock_kernels(n);
+            vector<vector<int>> full_vc(n, vector<int>(n, 0));
+            vector<vector<int>> diff_vc(n, vector<int>(n, 0));
+            vector<DiffState> ds(n, {vector<int>(n, 0), vector<int>(n, 0)});
+            vector<int> pairs;
+
+            long long messages = 0, diff_ints = 0;
+            double full_ns = 0, diff_ns = 0;
+            srand(12345 + n);
+
+            for (int e = 0; e < EVENTS_PER_PROCESS * n; ++e) {
+                int src = rand() % n;
+                int dest;
+                if (pattern == 0) {
+                    do { dest = rand() % n; } while (dest == src);
+                } else {
+                    int off = rand() % NEIGHBOURS - NEIGHBOURS / 2;
+                    if (off >= 0) off++;
+                    dest = ((src + off) % n + n) % n;
+                }
+
+                update(full_vc[src], src, {});
+                tick_diff(diff_vc[src], src, ds[src]);
+                encode_diff(diff_vc[src], src, dest, ds[src], pairs);
+                messages++;
+                diff_ints += pairs.size();
+
+                auto t0 = chrono::steady_clock::now();
+                update(full_vc[dest], dest, full_vc[src]);
+                auto t1 = chrono::steady_clock::now();
+                update_diff(diff_vc[dest], dest, pairs.data(), pairs.size(), ds[dest]);
+                auto t2 = chrono::steady_clock::now();
+
+                full_ns += chrono::duration<double, nano>(t1 - t0).count();
+                diff_ns += chrono::duration<double, nano>(t2 - t1).count();
+            }
+
+            if (full_vc != diff_vc) {
+                cerr << "Benchmark error: differential clocks diverged at N=" << n << endl;
+            }
+
+            stringstream ss;
+            ss << (pattern == 0 ? "random   " : "neighbour") << " "
+               << setw(5) << n << " "
+               << setw(12) << (double)n * sizeof(int) << " "
+               << setw(11) << (double)diff_ints * sizeof(int) / messages << " "
+               << setw(14) << full_ns / messages << " "
+               << setw(14) << diff_ns / messages;
+            cout << ss.str() << endl;
+        }
+    }
+}
+
+volatile long long kernel_sink;
+
+// merge/compare throughput of one kernel flavour over a pool of clocks.
+// b is always a strict successor of a, so compare never exits early; the
+// comparisons run first because merging makes a catch up with b.
+template <typename Merge, typename Compare>
+void time_kernels(const string& label, int n, vector<int*>& a, vector<int*>& b, Merge merge, Compare compare) {
+    const int pool = a.size();
+    const long long reps = max(20000LL, 200000000LL / n);
+    long long checksum = 0;
+
+    auto t0 = chrono::steady_clock::now();
+    for (long long r = 0; r < reps; ++r) {
+        checksum += compare(a[r % pool], b[r % pool]);
+    }
+    auto t1 = chrono::steady_clock::now();
+    for (long long r = 0; r < reps; ++r) {
+        merge(a[r % pool], b[(r * 7) % pool]);
+    }
+    auto t2 = chrono::steady_clock::now();
+    kernel_sink = checksum;
+
+    double compares = reps / chrono::duration<double>(t1 - t0).count();
+    double merges = reps / chrono::duration<double>(t2 - t1).count();
+    cout << setw(5) << n << "  " << setw(8) << label << " " << setw(13) << merges / 1e6
+         << " " << setw(15) << compares / 1e6 << endl;
+}
+
+template <size_t N>
+void bench_width(mt19937& rng) {
+    const int POOL = 64;
+    vector<VectorClock<N>> fa(POOL), fb(POOL);
+    for (int p = 0; p < POOL; ++p) {
+        for (size_t k = 0; k < N; ++k) {
+            fa[p].v[k] = rng() % 1000;
+            fb[p].v[k] = fa[p].v[k] + (k == N - 1 ? 1 : rng() % 2);
+        }
+    }
+    vector<VectorClock<N>> ga = fa, gb = fb;
+    vector<vector<int>> sa(POOL), sb(POOL);
+    vector<int*> pa, pb, qa, qb, ra, rb;
+    for (int p = 0; p < POOL; ++p) {
+        sa[p].assign(fa[p].v.begin(), fa[p].v.end());
+        sb[p].assign(fb[p].v.begin(), fb[p].v.end());
+        pa.push_back(sa[p].data()); pb.push_back(sb[p].data());
+        qa.push_back(ga[p].v.data()); qb.push_back(gb[p].v.data());
+        ra.push_back(fa[p].v.data()); rb.push_back(fb[p].v.data());
+    }
+
+    int n = N;
+    time_kernels("scalar", n, pa, pb,
+        [n](int* x, const int* y) { for (int k = 0; k < n; ++k) x[k] = max(x[k], y[k]); },
+        [n](const int* x, const int* y) {
+            bool le = true, ge = true;
+            for (int k = 0; k < n; ++k) { le &= x[k] <= y[k]; ge &= x[k] >= y[k]; }
+            return (int)(le && !ge);
+        });
+    time_kernels("simd", n, qa, qb,
+        [n](int* x, const int* y) { clock_max_merge(x, y, n); },
+        [n](const int* x, const int* y) { return (int)clock_happened_before(x, y, n); });
+    time_kernels("fixed", n, ra, rb,
+        [](int* x, const int* y) { clock_max_merge_fixed<N>(x, y, N); },
+        [](const int* x, const int* y) { return (int)(clock_compare_fixed<N>(x, y, N) == CLOCK_BEFORE); });
+}
+
+// merges and comparisons per second for scalar, runtime-width SIMD and
+// compile-time-width VectorClock<N> kernels
+void run_kernel_benchmark() {
+    mt19937 rng(42);
+    cout << "--- Vector Clock Kernel Benchmark ---" << endl;
+    cout << "    N    kernel   Mmerges/sec   Mcompares/sec" << endl;
+    bench_width<8>(rng);
+    bench_width<64>(rng);
+    bench_width<256>(rng);
+    bench_width<1024>(rng);
+}
+
+const int CAUSAL_TAG = 1;
+
+// causal broadcast benchmark: every rank broadcasts `per_rank` messages at
+// `rate` per second while delivering in causal order through the hold-back
+// queue; rank 0 reports throughput, delivery latency and hold-back depth
+void run_causal(int world_rank, int world_size, int per_rank, double rate) {
+    using Clock = chrono::steady_clock;
+    vector<float> latency_ns;
+    long long delivered = 0, order_violations = 0, held_on_arrival = 0, depth_sum = 0, arrivals = 0;
+    size_t max_depth = 0;
+
+    CausalBroadcast cb(world_rank, world_size, [&](const CausalBroadcast::Message& m) {
+        const vector<int>& now_vc = cb.delivered();
+        for (int k = 0; k < world_size; ++k) {
+            if (m.vc[k] > now_vc[k]) order_violations++;
+        }
+        long long sent_ns = ((long long)m.payload[1] << 32) | (unsigned)m.payload[2];
+        long long now_ns = chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+        latency_ns.push_back(now_ns - sent_ns);
+        delivered++;
+    });
+
+    // one buffer per broadcast, freed once all of its Isends completed
+    deque<pair<vector<int>, vector<MPI_Request>>> in_flight;
+    vector<int> recv_buffer(world_size + 3);
+    const long long expected = (long long)per_rank * world_size;
+    int sent = 0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = Clock::now();
+
+    while (delivered < expected || !in_flight.empty()) {
+        bool busy = false;
+        while (true) {
+            int flag = 0;
+            MPI_Message msg;
+            MPI_Status status;
+            MPI_Improbe(MPI_ANY_SOURCE, CAUSAL_TAG, MPI_COMM_WORLD, &flag, &msg, &status);
+            if (!flag) break;
+            MPI_Mrecv(recv_buffer.data(), recv_buffer.size(), MPI_INT, &msg, MPI_STATUS_IGNORE);
+            int src = status.MPI_SOURCE;
+            cb.receive(src, recv_buffer.data(), recv_buffer.data() + world_size, 3);
+            held_on_arrival += cb.held_from(src) > 0;
+            depth_sum += cb.held();
+            max_depth = max(max_depth, cb.held());
+            arrivals++;
+            busy = true;
+        }
+
+        double elapsed = chrono::duration<double>(Clock::now() - start).count();
+        if (sent < per_rank && sent < elapsed * rate) {
+            const vector<int>& vc = cb.stamp();
+            long long now_ns = chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+            in_flight.emplace_back(vc, vector<MPI_Request>(world_size - 1));
+            vector<int>& buf = in_flight.back().first;
+            buf.push_back(sent);
+            buf.push_back((int)(now_ns >> 32));
+            buf.push_back((int)(now_ns & 0xFFFFFFFF));
+            for (int dest = 0, r = 0; dest < world_size; ++dest) {
+                if (dest == world_rank) continue;
+                MPI_Isend(buf.data(), buf.size(), MPI_INT, dest, CAUSAL_TAG, MPI_COMM_WORLD, &in_flight.back().second[r++]);
+            }
+            delivered++;   // own broadcast is delivered locally at once
+            sent++;
+            busy = true;
+        }
+
+        while (!in_flight.empty()) {
+            int done = 0;
+            MPI_Testall(in_flight.front().second.size(), in_flight.front().second.data(), &done, MPI_STATUSES_IGNORE);
+            if (!done) break;
+            in_flight.pop_front();
+        }
+        if (!busy) this_thread::yield();
+    }
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+    long long local[5] = {delivered, order_violations, held_on_arrival, depth_sum, arrivals}, total[5];
+    MPI_Reduce(local, total, 5, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    double max_elapsed = 0;
+    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    unsigned long long depth = max_depth, global_max_depth = 0;
+    MPI_Reduce(&depth, &global_max_depth, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    int n_samples = latency_ns.size();
+    vector<int> counts(world_size), displs(world_size);
+    MPI_Gather(&n_samples, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    vector<float> all_ns;
+    if (world_rank == 0) {
+        int sum = 0;
+        for (int r = 0; r < world_size; ++r) { displs[r] = sum; sum += counts[r]; }
+        all_ns.resize(sum);
+    }
+    MPI_Gatherv(latency_ns.data(), n_samples, MPI_FLOAT, all_ns.data(), counts.data(), displs.data(), MPI_FLOAT, 0, MPI_COMM_WORLD);
+
+    if (world_rank == 0) {
+        sort(all_ns.begin(), all_ns.end());
+        cout << "--- Causal Broadcast Results ---" << endl;
+        cout << "ranks: " << world_size << ", broadcasts/rank: " << per_rank << ", target rate: " << rate
+             << " bcasts/sec/rank, duration: " << max_elapsed << " s" << endl;
+        cout << "deliveries: " << total[0] << " (" << total[0] / max_elapsed << "/sec), causal order violations: " << total[1] << endl;
+        cout << fixed << setprecision(1)
+             << "delivery latency us: p50 " << percentile(all_ns, 0.50) / 1e3 << ", p99 " << percentile(all_ns, 0.99) / 1e3
+             << ", p999 " << percentile(all_ns, 0.999) / 1e3 << ", max " << (all_ns.empty() ? 0 : all_ns.back() / 1e3) << endl;
+        cout << "hold-back: " << (total[4] ? 100.0 * total[2] / total[4] : 0) << "% of arrivals held, mean depth "
+             << (total[4] ? (double)total[3] / total[4] : 0) << ", max depth " << global_max_depth
+             << defaultfloat << endl;
+    }
+}
+
+const int ITC_TAG = 2;
+
+// deterministic initial stamp for a rank: the seed id is forked in halves
+// until there is one piece per rank, so no id has to be sent around
+ItcStamp itc_rank_stamp(int rank, int size) {
+    ItcStamp s = ItcStamp::seed();
+    int lo = 0, hi = size;
+    while (hi - lo > 1) {
+        int mid = lo + (hi - lo) / 2;
+        ItcStamp right = s.fork();
+        if (rank >= mid) { s = right; lo = mid; }
+        else hi = mid;
+    }
+    return s;
+}
+
+// same simulation loop as full/diff, but each rank hosts a changing set of
+// logical workers clocked with interval tree clocks; workers are forked
+// (spawned) and joined back (retired) without any global coordination
+void run_itc(int world_rank, int world_size) {
+    RankLog event_log("vector_clock", world_rank);
+    if (world_rank == 0) cout << "Per-event log: vector_clock.rank<N>.log" << endl;
+
+    vector<ItcStamp> workers = {itc_rank_stamp(world_rank, world_size)};
+    vector<MPI_Request> send_requests;
+    vector<vector<uint8_t>> send_buffers;
+    vector<uint8_t> recv_buffer;
+    const int NUM_ACTIONS = 20;
+    int received = 0;
+    vector<int> sent_to(world_size, 0);
+    auto receive = [&](const MPI_Status& status) {
+        int source = status.MPI_SOURCE;
+        int count = 0;
+        MPI_Get_count(&status, MPI_BYTE, &count);
+        recv_buffer.resize(count);
+        MPI_Recv(recv_buffer.data(), count, MPI_BYTE, source, ITC_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        received++;
+        itc::BitReader reader(recv_buffer.data(), count);
+        int w = rand() % workers.size();
+        workers[w].merge(itc::decode_event(reader));
+        workers[w].tick();
+        RLOG(LOG_INFO, EV_RECV, "Worker {a} received a {b}-byte stamp from Process {peer}.", source, ITC_TAG, 0, w, count);
+    };
+
+    for (int i = 0; i < NUM_ACTIONS; ++i) {
+        usleep((rand() % 80 + 20) * 1000);
+        int flag = 0;
+        MPI_Status status;
+
+        MPI_Iprobe(MPI_ANY_SOURCE, ITC_TAG, MPI_COMM_WORLD, &flag, &status);
+        if (flag) receive(status);
+
+        int action_choice = rand() % 5;
+        int w = rand() % workers.size();
+
+        if (action_choice == 0) { // Send event
+            workers[w].tick();
+            int dest = rand() % world_size;
+            while (dest == world_rank) {
+                dest = rand() % world_size;
+            }
+            send_buffers.push_back(workers[w].encode_event());
+            send_requests.emplace_back();
+            MPI_Isend(send_buffers.back().data(), send_buffers.back().size(), MPI_BYTE, dest, ITC_TAG, MPI_COMM_WORLD, &send_requests.back());
+            sent_to[dest]++;
+            RLOG(LOG_INFO, EV_SEND, "Worker {a} sent a {b}-byte stamp to Process {peer}.", dest, ITC_TAG, 0, w, send_buffers.back().size());
+        }
+        else if (action_choice == 1) { // Spawn a worker from w's id
+            workers.push_back(workers[w].fork());
+            RLOG(LOG_INFO, EV_STATE, "Worker {a} forked worker {b}.", -1, -1, 0, w, workers.size() - 1);
+        }
+        else if (action_choice == 2 && workers.size() > 1) { // Retire w into another worker
+            int into = (w + 1 + rand() % (workers.size() - 1)) % workers.size();
+            workers[into].absorb(workers[w]);
+            workers.erase(workers.begin() + w);
+            RLOG(LOG_INFO, EV_STATE, "Worker {a} retired into worker {b}.", -1, -1, 0, w, into - (into > w));
+        }
+        else { // Internal event
+            workers[w].tick();
+            RLOG(LOG_INFO, EV_INTERNAL, "Worker {a} internal event.", -1, -1, 0, w);
+        }
+    }
+
+    // receive every stamp still addressed to this rank; a send above the eager
+    // limit only completes once its receiver has matched it
+    int expected = 0;
+    MPI_Reduce_scatter_block(sent_to.data(), &expected, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    while (received < expected) {
+        MPI_Status status;
+        MPI_Probe(MPI_ANY_SOURCE, ITC_TAG, MPI_COMM_WORLD, &status);
+        receive(status);
+    }
+    MPI_Waitall(send_requests.size(), send_requests.data(), MPI_STATUSES_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    usleep(500 * 1000);
+
+    // retire every remaining worker into the first, leaving one stamp per rank
+    size_t peak = workers.size();
+    for (size_t k = 1; k < workers.size(); ++k) workers[0].absorb(workers[k]);
+    workers.resize(1);
+    vector<uint8_t> encoded = workers[0].encode();
+
+    if (world_rank == 0) {
+        cout << "\n--- FINAL STATES ---\n" << endl;
+    }
+    for (int rank = 0; rank < world_size; ++rank) {
+        if (world_rank == rank) {
+            cout << "[Process " << world_rank << "] Final state (" << peak << " workers before retiring, "
+                 << encoded.size() << " bytes) id: " << itc::id_to_string(workers[0].id)
+                 << " event: " << itc::event_to_string(workers[0].event) << endl;
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    // rank 0 joins every final stamp: the ids must add back up to the seed
+    int n_bytes = encoded.size();
+    vector<int> counts(world_size), displs(world_size);
+    MPI_Gather(&n_bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    vector<uint8_t> all;
+    if (world_rank == 0) {
+        int sum = 0;
+        for (int r = 0; r < world_size; ++r) { displs[r] = sum; sum += counts[r]; }
+        all.resize(sum);
+    }
+    MPI_Gatherv(encoded.data(), n_bytes, MPI_BYTE, all.data(), counts.data(), displs.data(), MPI_BYTE, 0, MPI_COMM_WORLD);
+    if (world_rank == 0) {
+        ItcStamp joined{itc::id_leaf(0), itc::ev_leaf(0)};
+        for (int r = 0; r < world_size; ++r) {
+            itc::BitReader reader(all.data() + displs[r], counts[r]);
+            ItcStamp s;
+            s.id = itc::decode_id(reader);
+            s.event = itc::decode_event(reader);
+            joined.absorb(s);
+        }
+        cout << "Joined id: " << itc::id_to_string(joined.id)
+             << (itc::is_id(joined.id, 1) ? " (whole id space reclaimed)" : " (id space NOT reclaimed)")
+             << ", joined event: " << itc::event_to_string(joined.event) << endl;
+    }
+}
+
+// interval tree clocks vs vector clocks under worker churn, in one address
+// space. every retire+spawn pair gives the vector clock a fresh index that is
+// never reclaimed, while the ITC id of the retired worker is joined back.
+void run_itc_benchmark() {
+    const int worker_counts[] = {16, 64, 256};
+    const double churn_rates[] = {0.0, 0.1, 0.3};
+    const int OPS_PER_WORKER = 50;
+
+    cout << "--- Interval Tree Clock vs Vector Clock Under Churn ---" << endl;
+    cout << "workers  churn  vc entries  vc B/msg  itc B/msg  vc ns/merge  itc ns/merge  order mismatches" << endl;
+
+    for (int n : worker_counts) {
+        for (double churn : churn_rates) {
+            mt19937 rng(777 + n);
+            vector<ItcStamp> itc_w = {ItcStamp::seed()};
+            vector<vector<int>> vc_w = {vector<int>(1, 0)};
+            vector<int> vc_index = {0};
+            int width = 1;
+
+            // a live vector clock is padded lazily up to the current width
+            auto widen = [&](vector<int>& v) { if ((int)v.size() < width) v.resize(width, 0); };
+            auto spawn = [&](int from) {
+                itc_w.push_back(itc_w[from].fork());
+                vc_w.push_back(vc_w[from]);
+                vc_index.push_back(width++);
+            };
+            while ((int)itc_w.size() < n) spawn(rng() % itc_w.size());
+
+            long long messages = 0, itc_bytes = 0, vc_bytes = 0;
+            double itc_ns = 0, vc_ns = 0;
+            for (int op = 0; op < OPS_PER_WORKER * n; ++op) {
+                if (uniform_real_distribution<double>(0, 1)(rng) < churn) {
+                    int w = rng() % itc_w.size();
+                    int into = (w + 1 + rng() % (itc_w.size() - 1)) % itc_w.size();
+                    itc_w[into].absorb(itc_w[w]);
+                    widen(vc_w[into]); widen(vc_w[w]);
+                    clock_max_merge(vc_w[into].data(), vc_w[w].data(), width);
+                    itc_w.erase(itc_w.begin() + w);
+                    vc_w.erase(vc_w.begin() + w);
+                    vc_index.erase(vc_index.begin() + w);
+                    spawn(rng() % itc_w.size());
+                    continue;
+                }
+
+                int src = rng() % itc_w.size();
+                int dest = rng() % (itc_w.size() - 1);
+                if (dest >= src) dest++;
+                itc_w[src].tick();
+                widen(vc_w[src]);
+                vc_w[src][vc_index[src]]++;
+
+                vector<uint8_t> msg = itc_w[src].encode_event();
+                messages++;
+                itc_bytes += msg.size();
+                vc_bytes += (long long)width * sizeof(int);
+
+                auto t0 = chrono::steady_clock::now();
+                itc::BitReader reader(msg.data(), msg.size());
+                itc_w[dest].merge(itc::decode_event(reader));
+                itc_w[dest].tick();
+                auto t1 = chrono::steady_clock::now();
+                widen(vc_w[dest]);
+                clock_max_merge(vc_w[dest].data(), vc_w[src].data(), width);
+                vc_w[dest][vc_index[dest]]++;
+                auto t2 = chrono::steady_clock::now();
+
+                itc_ns += chrono::duration<double, nano>(t1 - t0).count();
+                vc_ns += chrono::duration<double, nano>(t2 - t1).count();
+            }
+
+            // both engines must order every pair of live workers the same way
+            long long mismatches = 0;
+            for (int k = 0; k < 2000; ++k) {
+                int a = rng() % itc_w.size(), b = rng() % itc_w.size();
+                widen(vc_w[a]); widen(vc_w[b]);
+                ClockOrder order = clock_compare(vc_w[a].data(), vc_w[b].data(), width);
+                bool vc_leq = order == CLOCK_EQUAL || order == CLOCK_BEFORE;
+                mismatches += vc_leq != itc_w[a].leq(itc_w[b]);
+            }
+
+            stringstream ss;
+            ss << setw(7) << n << " " << setw(6) << churn << " " << setw(11) << width << " "
+               << setw(9) << (double)vc_bytes / messages << " " << setw(10) << (double)itc_bytes / messages << " "
+               << setw(12) << vc_ns / messages << " " << setw(13) << itc_ns / messages << " "
+               << setw(17) << mismatches;
+            cout << ss.str() << endl;
+        }
+    }
 }
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int world_rank, world_size;
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+    // usage: vector_clock [full|diff|bench|kernels|itc|itc-bench] [load <msgs/sec> <seconds>]
+    //        vector_clock causal [broadcasts/rank] [bcasts/sec/rank]
+    //        vector_clock itc  (interval tree clocks over spawned/retired workers)
+    string mode = argc > 1 ? argv[1] : "full";
+    if (mode == "causal") {
+        run_causal(world_rank, world_size, argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? atof(argv[3]) : 1000);
+        MPI_Finalize();
+        return 0;
+    }
+    if (mode == "itc") {
+        srand(time(NULL) + world_rank);
+        run_itc(world_rank, world_size);
+        MPI_Finalize();
+        return 0;
+    }
+    if (mode == "bench" || mode == "kernels" || mode == "itc-bench") {
+        if (world_rank == 0) {
+            if (mode == "bench") run_benchmark();
+            else if (mode == "kernels") run_kernel_benchmark();
+            else run_itc_benchmark();
+        }
+        MPI_Finalize();
+        return 0;
+    }
+    const bool differential = (mode == "diff");
+    const LoadOptions load = parse_load_options(argc, argv, 2);
+
     w_s = world_size;
+    vc_kernels = select_clock_kernels(world_size);
     srand(time(NULL) + world_rank);
 
     vector<int> my_vc(world_size, 0);
+    DiffState ds = {vector<int>(world_size, 0), vector<int>(world_size, 0)};
+    vector<int> recv_buffer(2 * world_size);
+
+    if (load.enabled) {
+        // tracing under load is opt-in so it does not skew the latency numbers
+        unique_ptr<VcTraceWriter> trace;
+        if (getenv("VC_TRACE")) trace.reset(new VcTraceWriter(trace_path(world_rank), world_rank, world_size));
+
+        run_load<int>(world_rank, world_size, MPI_INT, load, differential ? "vector clock, diff" : "vector clock, full",
+            [&](int dest, vector<int>& out) {
+                tick_diff(my_vc, world_rank, ds);
+                if (differential) encode_diff(my_vc, world_rank, dest, ds, out);
+                else out = my_vc;
+                if (trace) trace->record(VC_SEND, dest, -1, my_vc.data());
+            },
+            [&](int source, const vector<int>& buf, int count) {
+                int sent_at = trace ? sender_event(buf.data(), count, source, differential) : -1;
+                if (differential) update_diff(my_vc, world_rank, buf.data(), count, ds);
+                else update(my_vc, world_rank, buf);
+                if (trace) trace->record(VC_RECEIVE, source, sent_at, my_vc.data());
+            });
+        trace.reset();
+        MPI_Finalize();
+        return 0;
+    }
+
+    RankLog event_log("vector_clock", world_rank);
+    VcTraceWriter trace(trace_path(world_rank), world_rank, world_size);
+    if (world_rank == 0) cout << "Per-event log: vector_clock.rank<N>.log" << endl;
+    vector<MPI_Request> send_requests;
+    vector<vector<int>> send_buffers;
     const int NUM_ACTIONS = 10; 
+    int received = 0;
+    vector<int> sent_to(world_size, 0);
+    auto receive = [&](const MPI_Status& status) {
+        int source = status.MPI_SOURCE;
+        int count = 0;
+        MPI_Get_count(&status, MPI_INT, &count);
+        MPI_Recv(recv_buffer.data(), count, MPI_INT, source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        received++;
+        int sent_at = sender_event(recv_buffer.data(), count, source, differential);
+        if (differential) {
+            RLOG(LOG_INFO, EV_RECV, "Received {a} clock entries from Process {peer}.", source, 0, 0, count / 2);
+            update_diff(my_vc, world_rank, recv_buffer.data(), count, ds);
+        } else {
+            RLOG(LOG_INFO, EV_RECV, "Received clock from Process {peer}.", source, 0);
+            update(my_vc, world_rank, recv_buffer);
+        }
+        trace.record(VC_RECEIVE, source, sent_at, my_vc.data());
+        RLOG(LOG_INFO, EV_STATE, "Updated after receive. VC[own]: {clock}", -1, -1, my_vc[world_rank]);
+    };
 
     for (int i = 0; i < NUM_ACTIONS; ++i) {
         usleep((rand() % 80 + 20) * 1000);
@@ -52,33 +677,44 @@ int main(int argc, char** argv) {
         MPI_Status status;
 
         MPI_Iprobe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &flag, &status);
-        if (flag) {
-            int source = status.MPI_SOURCE;
-            vector<int> received_vc(world_size);
-            MPI_Recv(received_vc.data(), world_size, MPI_INT, source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            cout << "[Process " << world_rank << "] Received clock from Process " << source << "." << endl;
-            update(my_vc, world_rank, received_vc);
-            print_vc(world_rank, "Updated after receive.", my_vc);
-        }
+        if (flag) receive(status);
 
         int action_choice = rand() % 3;
 
         if (action_choice == 0) { // Send event
-            update(my_vc, world_rank, {});
+            tick_diff(my_vc, world_rank, ds);
             int dest = rand() % world_size;
             while (dest == world_rank) {
                 dest = rand() % world_size;
             }
-            MPI_Request send_request;
-            MPI_Isend(my_vc.data(), world_size, MPI_INT, dest, 0, MPI_COMM_WORLD, &send_request);
-            cout << "[Process " << world_rank << "] Sent clock to Process " << dest << "." << endl;
+            // each Isend keeps its own buffer alive until the final Waitall
+            send_buffers.emplace_back();
+            if (differential) encode_diff(my_vc, world_rank, dest, ds, send_buffers.back());
+            else send_buffers.back() = my_vc;
+            trace.record(VC_SEND, dest, -1, my_vc.data());
+            send_requests.emplace_back();
+            MPI_Isend(send_buffers.back().data(), send_buffers.back().size(), MPI_INT, dest, 0, MPI_COMM_WORLD, &send_requests.back());
+            sent_to[dest]++;
+            RLOG(LOG_INFO, EV_SEND, "Sent {a} clock entries to Process {peer}. VC[own]: {clock}", dest, 0, my_vc[world_rank],
+                 differential ? send_buffers.back().size() / 2 : world_size);
         } 
         else { // Internal event
-            update(my_vc, world_rank, {});
-            print_vc(world_rank, "Internal event.", my_vc);
+            tick_diff(my_vc, world_rank, ds);
+            trace.record(VC_INTERNAL, -1, -1, my_vc.data());
+            RLOG(LOG_INFO, EV_INTERNAL, "Internal event. VC[own]: {clock}", -1, -1, my_vc[world_rank]);
         }
     }
 
+    // receive every clock still addressed to this rank; a send above the eager
+    // limit only completes once its receiver has matched it
+    int expected = 0;
+    MPI_Reduce_scatter_block(sent_to.data(), &expected, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    while (received < expected) {
+        MPI_Status status;
+        MPI_Probe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &status);
+        receive(status);
+    }
+    MPI_Waitall(send_requests.size(), send_requests.data(), MPI_STATUSES_IGNORE);
     MPI_Barrier(MPI_COMM_WORLD);
     usleep(500 * 1000);
 
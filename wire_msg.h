@@ -0,0 +1,143 @@
+#pragma once
+
+// Fixed-layout protocol messages shared by the Maekawa and Paxos programs.
+// Every message is one WireMsg header, sent with one MPI call as a committed
+// MPI struct datatype. A message that needs more than the header carries
+// `length` ints of payload in the slots that follow it, in the same send.
+// The payload is padded to whole WireMsg slots, so one datatype covers every
+// message. A header-only message goes out with a blocking MPI_Send, which
+// stays under any eager limit. A message with a payload goes out with
+// MPI_Isend from a buffer the channel owns until the send completes. A
+// blocking send of a large payload would wait for a matching receive, and
+// two ranks sending to each other would then both stall without polling.
+// Receives use MPI_Improbe/MPI_Mrecv into a buffer that is reused and grows
+// only when a longer message shows up, so the hot path neither allocates nor
+// makes a second receive call. Completed send buffers are recycled the same
+// way.
+
+#include <mpi.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+
+struct WireMsg {
+    int32_t tag;       // message kind; also the MPI tag it travels under
+    int32_t sender;
+    int32_t ts;        // Lamport timestamp or ballot
+    int32_t value;
+    int32_t aux;       // second value, e.g. the last accepted ballot in a Paxos promise
+    int32_t length;    // payload ints that follow the header
+};
+static_assert(sizeof(WireMsg) == 6 * sizeof(int32_t), "WireMsg must be unpadded");
+
+class WireChannel {
+public:
+    static const int SLOT_INTS = sizeof(WireMsg) / sizeof(int32_t);
+
+    // point-to-point traffic on comm; constructing the channel is local
+    WireChannel(MPI_Comm comm) : comm_(comm) {
+        int size;
+        MPI_Comm_size(comm_, &size);
+        sent_to_.assign(size, 0);
+        recv_buffer_.resize(4);
+
+        const int blocks[6] = {1, 1, 1, 1, 1, 1};
+        const MPI_Aint displs[6] = {offsetof(WireMsg, tag), offsetof(WireMsg, sender), offsetof(WireMsg, ts),
+                                    offsetof(WireMsg, value), offsetof(WireMsg, aux), offsetof(WireMsg, length)};
+        const MPI_Datatype types[6] = {MPI_INT32_T, MPI_INT32_T, MPI_INT32_T, MPI_INT32_T, MPI_INT32_T, MPI_INT32_T};
+        MPI_Datatype loose;
+        MPI_Type_create_struct(6, blocks, displs, types, &loose);
+        MPI_Type_create_resized(loose, 0, sizeof(WireMsg), &type_);
+        MPI_Type_free(&loose);
+        MPI_Type_commit(&type_);
+    }
+
+    // every send has completed once its receiver has drained it, e.g. after quiescence
+    ~WireChannel() {
+        while (!in_flight_.empty()) {
+            MPI_Wait(&in_flight_.front().request, MPI_STATUS_IGNORE);
+            in_flight_.pop_front();
+        }
+        MPI_Type_free(&type_);
+    }
+
+    WireChannel(const WireChannel&) = delete;
+    WireChannel& operator=(const WireChannel&) = delete;
+
+    void send(int dest, WireMsg m, const int32_t* payload = nullptr, int length = 0) {
+        m.length = length;
+        if (length == 0) MPI_Send(&m, 1, type_, dest, m.tag, comm_);
+        else {
+            reap_sends();
+            int slots = 1 + (length + SLOT_INTS - 1) / SLOT_INTS;
+            std::vector<WireMsg> buffer;
+            if (!spare_.empty()) {
+                buffer.swap(spare_.back());
+                spare_.pop_back();
+            }
+            if ((int)buffer.size() < slots) buffer.resize(slots);
+            buffer[0] = m;
+            std::memcpy(&buffer[1], payload, length * sizeof(int32_t));
+            in_flight_.push_back({MPI_REQUEST_NULL, std::move(buffer)});
+            PendingSend& s = in_flight_.back();
+            MPI_Isend(s.data.data(), slots, type_, dest, m.tag, comm_, &s.request);
+        }
+        sent_to_[dest]++;
+        calls_++;
+    }
+
+    // hand every pending message to fn(const WireMsg&, const int32_t* payload);
+    // the payload pointer is only valid during the call
+    template <class Fn>
+    bool poll(Fn fn) {
+        reap_sends();
+        bool any = false;
+        while (true) {
+            int flag = 0;
+            MPI_Message msg;
+            MPI_Status status;
+            MPI_Improbe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm_, &flag, &msg, &status);
+            if (!flag) break;
+            int slots = 0;
+            MPI_Get_count(&status, type_, &slots);
+            if ((int)recv_buffer_.size() < slots) recv_buffer_.resize(slots);
+            MPI_Mrecv(recv_buffer_.data(), slots, type_, &msg, MPI_STATUS_IGNORE);
+            calls_ += 2;
+            received_++;
+            fn(recv_buffer_[0], reinterpret_cast<const int32_t*>(recv_buffer_.data() + 1));
+            any = true;
+        }
+        return any;
+    }
+
+    // messages sent to each rank and received by this one, for quiescence detection
+    const std::vector<int>& sent_to() const { return sent_to_; }
+    long long received() const { return received_; }
+    // data-moving MPI calls: one per send, probe + receive per incoming message
+    long long calls() const { return calls_; }
+
+private:
+    struct PendingSend { MPI_Request request; std::vector<WireMsg> data; };
+
+    // hand the buffers of completed sends back for reuse, oldest first
+    void reap_sends() {
+        while (!in_flight_.empty()) {
+            int done = 0;
+            MPI_Test(&in_flight_.front().request, &done, MPI_STATUS_IGNORE);
+            if (!done) break;
+            spare_.push_back(std::move(in_flight_.front().data));
+            in_flight_.pop_front();
+        }
+    }
+
+    MPI_Comm comm_;
+    MPI_Datatype type_;
+    std::vector<int> sent_to_;
+    std::vector<WireMsg> recv_buffer_;
+    std::deque<PendingSend> in_flight_;
+    std::vector<std::vector<WireMsg>> spare_;
+    long long received_ = 0, calls_ = 0;
+};